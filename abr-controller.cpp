@@ -0,0 +1,120 @@
+#include "abr-controller.hpp"
+#include "trace.hpp"
+
+// Congestion or drop ratio above these counts as a bad sample
+#define ABR_CONGESTION_THRESHOLD 0.25f
+#define ABR_DROP_THRESHOLD 0.01
+
+// Hysteresis, in samples of the dock timer (500 ms)
+#define ABR_BAD_SAMPLES_DOWN 2
+#define ABR_GOOD_SAMPLES_UP 20
+
+// Step sizes in percent of the current bitrate
+#define ABR_STEP_DOWN 20
+#define ABR_STEP_UP 5
+
+AbrController::AbrController(obs_output_t *output_, obs_encoder_t *encoder_, obs_data_t *settings)
+	: output(obs_output_get_ref(output_)),
+	  encoder(obs_encoder_get_ref(encoder_))
+{
+	UpdateSettings(settings);
+	lastDropped = obs_output_get_frames_dropped(output);
+	lastTotal = obs_output_get_total_frames(output);
+}
+
+AbrController::~AbrController()
+{
+	obs_encoder_release(encoder);
+	obs_output_release(output);
+}
+
+bool AbrController::Supported(const char *encoder_id)
+{
+	if (!encoder_id || encoder_id[0] == '\0')
+		return false;
+	return (obs_get_encoder_caps(encoder_id) & OBS_ENCODER_CAP_DYN_BITRATE) != 0;
+}
+
+void AbrController::UpdateSettings(obs_data_t *settings)
+{
+	auto ves = obs_data_get_obj(settings, "video_encoder_settings");
+	long long configured = ves ? obs_data_get_int(ves, "bitrate") : 0;
+	obs_data_release(ves);
+
+	maxBitrate = obs_data_get_int(settings, "abr_max_bitrate");
+	if (maxBitrate <= 0)
+		maxBitrate = configured;
+	minBitrate = obs_data_get_int(settings, "abr_min_bitrate");
+	if (minBitrate <= 0 || minBitrate > maxBitrate)
+		minBitrate = maxBitrate / 4;
+
+	currentBitrate = configured > 0 ? configured : maxBitrate;
+	if (currentBitrate > maxBitrate)
+		currentBitrate = maxBitrate;
+	if (currentBitrate < minBitrate)
+		currentBitrate = minBitrate;
+	priority = (int)obs_data_get_int(settings, "priority");
+	badSamples = 0;
+	goodSamples = 0;
+}
+
+void AbrController::SetCeiling(long long bitrate)
+{
+	if (bitrate == ceiling)
+		return;
+	ceiling = bitrate;
+	if (ceiling > 0 && currentBitrate > ceiling)
+		SetBitrate(ceiling);
+}
+
+void AbrController::Tick()
+{
+	TRACE_SCOPE("AbrController::Tick");
+	if (maxBitrate <= 0 || !obs_output_active(output))
+		return;
+
+	int dropped = obs_output_get_frames_dropped(output);
+	int total = obs_output_get_total_frames(output);
+	int droppedDelta = dropped - lastDropped;
+	int totalDelta = total - lastTotal;
+	lastDropped = dropped;
+	lastTotal = total;
+
+	double dropRatio = totalDelta > 0 ? (double)droppedDelta / (double)totalDelta : 0.0;
+	float congestion = obs_output_get_congestion(output);
+
+	if (congestion > ABR_CONGESTION_THRESHOLD || dropRatio > ABR_DROP_THRESHOLD) {
+		goodSamples = 0;
+		if (++badSamples < ABR_BAD_SAMPLES_DOWN)
+			return;
+		badSamples = 0;
+		SetBitrate(currentBitrate - currentBitrate * ABR_STEP_DOWN / 100);
+	} else {
+		badSamples = 0;
+		if (++goodSamples < ABR_GOOD_SAMPLES_UP)
+			return;
+		goodSamples = 0;
+		SetBitrate(currentBitrate + currentBitrate * ABR_STEP_UP / 100 + 1);
+	}
+}
+
+void AbrController::SetBitrate(long long bitrate)
+{
+	if (bitrate > maxBitrate)
+		bitrate = maxBitrate;
+	if (ceiling > 0 && bitrate > ceiling)
+		bitrate = ceiling;
+	if (bitrate < minBitrate)
+		bitrate = minBitrate;
+	if (bitrate == currentBitrate)
+		return;
+
+	blog(LOG_INFO, "[Aitum Multistream] adaptive bitrate '%s' %lld -> %lld Kbps", obs_output_get_name(output), currentBitrate,
+	     bitrate);
+	currentBitrate = bitrate;
+
+	auto s = obs_data_create();
+	obs_data_set_int(s, "bitrate", bitrate);
+	obs_encoder_update(encoder, s);
+	obs_data_release(s);
+}
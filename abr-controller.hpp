@@ -0,0 +1,41 @@
+#pragma once
+
+#include <obs.h>
+
+// Steps the bitrate of a custom video encoder down when its output gets congested or drops frames,
+// and back up once the connection has been healthy for a while.
+class AbrController {
+public:
+	AbrController(obs_output_t *output, obs_encoder_t *encoder, obs_data_t *settings);
+	~AbrController();
+
+	void UpdateSettings(obs_data_t *settings);
+	void Tick();
+	// Upper limit set by the upload budget, 0 removes it
+	void SetCeiling(long long bitrate);
+
+	obs_output_t *GetOutput() const { return output; }
+	long long GetBitrate() const { return currentBitrate; }
+	long long GetMinBitrate() const { return minBitrate; }
+	long long GetMaxBitrate() const { return maxBitrate; }
+	int GetPriority() const { return priority; }
+
+	static bool Supported(const char *encoder_id);
+
+private:
+	obs_output_t *output;
+	obs_encoder_t *encoder;
+
+	long long minBitrate = 0;
+	long long maxBitrate = 0;
+	long long currentBitrate = 0;
+	long long ceiling = 0;
+	int priority = 0;
+
+	int lastDropped = 0;
+	int lastTotal = 0;
+	int badSamples = 0;
+	int goodSamples = 0;
+
+	void SetBitrate(long long bitrate);
+};
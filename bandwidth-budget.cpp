@@ -0,0 +1,96 @@
+#include "bandwidth-budget.hpp"
+#include "abr-controller.hpp"
+#include <util/platform.h>
+#include <vector>
+
+void BandwidthBudget::Sample(const std::string &key, obs_output_t *output, long long configured)
+{
+	auto &s = samples[key];
+	uint64_t bytes = obs_output_get_total_bytes(output);
+	uint64_t now = os_gettime_ns();
+	if (s.time && now > s.time && bytes >= s.bytes)
+		s.measured = (long long)((bytes - s.bytes) * 8 * 1000000 / (now - s.time));
+	s.bytes = bytes;
+	s.time = now;
+	s.configured = configured;
+	s.seen = true;
+}
+
+void BandwidthBudget::EndTick()
+{
+	usage = 0;
+	for (auto it = samples.begin(); it != samples.end();) {
+		if (!it->second.seen) {
+			it = samples.erase(it);
+			continue;
+		}
+		usage += it->second.measured > 0 ? it->second.measured : it->second.configured;
+		it->second.seen = false;
+		it++;
+	}
+}
+
+long long BandwidthBudget::GetKbps(const std::string &key) const
+{
+	auto it = samples.find(key);
+	if (it == samples.end())
+		return 0;
+	return it->second.measured > 0 ? it->second.measured : it->second.configured;
+}
+
+int BandwidthBudget::PriorityWeight(int priority)
+{
+	if (priority < 0)
+		return 1;
+	if (priority > 0)
+		return 4;
+	return 2;
+}
+
+void BandwidthBudget::Allocate(long long budget, const std::map<std::string, AbrController *> &controllers)
+{
+	if (controllers.empty())
+		return;
+	if (budget <= 0) {
+		for (auto it = controllers.begin(); it != controllers.end(); it++)
+			it->second->SetCeiling(0);
+		return;
+	}
+
+	// What the adaptive outputs can use is the budget minus everything else
+	long long available = budget - usage;
+	for (auto it = controllers.begin(); it != controllers.end(); it++)
+		available += it->second->GetBitrate();
+
+	// Everyone gets the minimum, the rest is filled up by priority weight until each maximum is reached
+	std::vector<std::pair<AbrController *, long long>> shares;
+	for (auto it = controllers.begin(); it != controllers.end(); it++) {
+		shares.emplace_back(it->second, it->second->GetMinBitrate());
+		available -= it->second->GetMinBitrate();
+	}
+	while (available > 0) {
+		long long weights = 0;
+		for (auto &share : shares) {
+			if (share.second < share.first->GetMaxBitrate())
+				weights += PriorityWeight(share.first->GetPriority());
+		}
+		if (!weights)
+			break;
+		long long handed_out = 0;
+		for (auto &share : shares) {
+			long long room = share.first->GetMaxBitrate() - share.second;
+			if (room <= 0)
+				continue;
+			long long part = available * PriorityWeight(share.first->GetPriority()) / weights;
+			if (part > room)
+				part = room;
+			share.second += part;
+			handed_out += part;
+		}
+		if (!handed_out)
+			break;
+		available -= handed_out;
+	}
+	for (auto &share : shares)
+		share.first->SetCeiling(share.second);
+}
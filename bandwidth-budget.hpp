@@ -0,0 +1,34 @@
+#pragma once
+
+#include <obs.h>
+#include <map>
+#include <string>
+
+class AbrController;
+
+// Sums the upload of all live outputs, measured from their sent bytes or taken from the encoder settings
+// until a measurement exists, and shares the budget left over between adaptive bitrate outputs by priority
+class BandwidthBudget {
+public:
+	void Sample(const std::string &key, obs_output_t *output, long long configured);
+	void EndTick();
+	void Reserve(long long bitrate) { usage += bitrate; }
+
+	long long GetUsage() const { return usage; }
+	long long GetKbps(const std::string &key) const;
+
+	void Allocate(long long budget, const std::map<std::string, AbrController *> &controllers);
+
+	static int PriorityWeight(int priority);
+
+private:
+	struct sample {
+		uint64_t bytes = 0;
+		uint64_t time = 0;
+		long long measured = 0;
+		long long configured = 0;
+		bool seen = false;
+	};
+	std::map<std::string, sample> samples;
+	long long usage = 0;
+};
@@ -0,0 +1,505 @@
+#include "capacity-planner.hpp"
+#include <obs-module.h>
+#include <util/dstr.h>
+#include <util/platform.h>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <random>
+
+#define CAPACITY_OUTPUT_ID "aitum_multistream_capacity_output"
+#define CAPACITY_WARMUP_MS 1000
+// Share of the frames that have to come out of the encoder for it to count as keeping up
+#define CAPACITY_KEEP_UP_RATIO 0.95
+
+static std::string capacity_preset(obs_data_t *settings)
+{
+	std::string preset;
+	auto item = obs_data_item_byname(settings, "preset");
+	if (item && obs_data_item_gettype(item) == OBS_DATA_STRING)
+		preset = obs_data_item_get_string(item);
+	else if (item && obs_data_item_gettype(item) == OBS_DATA_NUMBER)
+		preset = std::to_string(obs_data_item_get_int(item));
+	obs_data_item_release(&item);
+	return preset;
+}
+
+static std::string capacity_encoder_preset(const char *encoder_id, obs_data_t *settings)
+{
+	auto merged = obs_encoder_defaults(encoder_id);
+	if (!merged)
+		merged = obs_data_create();
+	if (settings)
+		obs_data_apply(merged, settings);
+	auto preset = capacity_preset(merged);
+	obs_data_release(merged);
+	return preset;
+}
+
+static double capacity_fps(uint32_t divisor)
+{
+	struct obs_video_info ovi;
+	if (!obs_get_video_info(&ovi) || !ovi.fps_den)
+		return 0.0;
+	return (double)ovi.fps_num / (double)ovi.fps_den / (double)(divisor ? divisor : 1);
+}
+
+bool capacity_workload_from_settings(obs_data_t *settings, bool vertical, encoder_workload &workload)
+{
+	if (!obs_data_get_bool(settings, "advanced"))
+		return false;
+	auto encoder_id = obs_data_get_string(settings, "video_encoder");
+	if (!encoder_id || !*encoder_id)
+		return false;
+	workload.name = obs_data_get_string(settings, "name");
+	workload.encoder_id = encoder_id;
+	auto ves = obs_data_get_obj(settings, "video_encoder_settings");
+	workload.settings_json = ves ? obs_data_get_json(ves) : "";
+	workload.preset = capacity_encoder_preset(encoder_id, ves);
+	obs_data_release(ves);
+	auto divisor = obs_data_get_int(settings, "frame_rate_divisor");
+	workload.divisor = divisor > 1 ? (uint32_t)divisor : 1;
+
+	workload.width = obs_data_get_bool(settings, "scale") ? (uint32_t)obs_data_get_int(settings, "width") : 0;
+	workload.height = obs_data_get_bool(settings, "scale") ? (uint32_t)obs_data_get_int(settings, "height") : 0;
+	if (workload.width && workload.height)
+		return true;
+	video_t *video = nullptr;
+	if (vertical) {
+		struct calldata cd;
+		calldata_init(&cd);
+		if (proc_handler_call(obs_get_proc_handler(), "aitum_vertical_get_video", &cd))
+			video = (video_t *)calldata_ptr(&cd, "video");
+		calldata_free(&cd);
+	} else {
+		video = obs_get_video();
+	}
+	if (!video)
+		return false;
+	workload.width = video_output_get_width(video);
+	workload.height = video_output_get_height(video);
+	return workload.width && workload.height;
+}
+
+obs_data_t *capacity_load_costs()
+{
+	obs_data_t *costs = nullptr;
+	char *path = obs_module_config_path("encoder-costs.json");
+	if (path) {
+		costs = obs_data_create_from_json_file_safe(path, "bak");
+		bfree(path);
+	}
+	return costs ? costs : obs_data_create();
+}
+
+static bool capacity_same_encoder(obs_data_t *cost, const encoder_workload &workload)
+{
+	return workload.encoder_id == obs_data_get_string(cost, "encoder") &&
+	       workload.preset == obs_data_get_string(cost, "preset");
+}
+
+capacity_estimate capacity_estimate_workload(obs_data_t *costs, const encoder_workload &workload)
+{
+	capacity_estimate estimate;
+	if ((obs_get_encoder_caps(workload.encoder_id.c_str()) & OBS_ENCODER_CAP_PASS_TEXTURE) != 0) {
+		// Encodes on the GPU from textures, the CPU side is negligible
+		estimate.known = true;
+		estimate.hardware = true;
+		return estimate;
+	}
+	const double fps = capacity_fps(workload.divisor);
+	const double rate = (double)workload.width * (double)workload.height * fps;
+	if (rate <= 0.0)
+		return estimate;
+
+	auto entries = obs_data_get_array(costs, "costs");
+	double closest = 0.0;
+	obs_data_t *best = nullptr;
+	size_t count = obs_data_array_count(entries);
+	for (size_t i = 0; i < count; i++) {
+		auto cost = obs_data_array_item(entries, i);
+		double entry_rate = (double)obs_data_get_int(cost, "width") * (double)obs_data_get_int(cost, "height") *
+				    obs_data_get_double(cost, "fps");
+		if (!capacity_same_encoder(cost, workload) || entry_rate <= 0.0) {
+			obs_data_release(cost);
+			continue;
+		}
+		double distance = std::fabs(std::log(rate / entry_rate));
+		if (!best || distance < closest) {
+			obs_data_release(best);
+			best = cost;
+			closest = distance;
+		} else {
+			obs_data_release(cost);
+		}
+	}
+	obs_data_array_release(entries);
+	if (!best)
+		return estimate;
+
+	double entry_rate = (double)obs_data_get_int(best, "width") * (double)obs_data_get_int(best, "height") *
+			    obs_data_get_double(best, "fps");
+	estimate.known = true;
+	estimate.measured = closest < 0.001;
+	estimate.cpu = obs_data_get_double(best, "cpu") * rate / entry_rate;
+	// A smaller workload that could not keep up will not keep up at this size either
+	estimate.lagging = obs_data_get_bool(best, "lagging") && rate >= entry_rate * 0.999;
+	obs_data_release(best);
+	return estimate;
+}
+
+struct capacity_output {
+	obs_output_t *output;
+	std::atomic<uint64_t> packets = 0;
+	std::atomic<bool> failed = false;
+};
+
+static const char *capacity_output_name(void *type_data)
+{
+	UNUSED_PARAMETER(type_data);
+	return "Aitum Multistream Capacity Benchmark";
+}
+
+static void *capacity_output_create(obs_data_t *settings, obs_output_t *output)
+{
+	UNUSED_PARAMETER(settings);
+	auto co = new capacity_output;
+	co->output = output;
+	return co;
+}
+
+static void capacity_output_destroy(void *data)
+{
+	delete (capacity_output *)data;
+}
+
+static bool capacity_output_start(void *data)
+{
+	auto co = (capacity_output *)data;
+	if (!obs_output_can_begin_data_capture(co->output, 0) || !obs_output_initialize_encoders(co->output, 0))
+		return false;
+	return obs_output_begin_data_capture(co->output, 0);
+}
+
+static void capacity_output_stop(void *data, uint64_t ts)
+{
+	UNUSED_PARAMETER(ts);
+	auto co = (capacity_output *)data;
+	obs_output_end_data_capture(co->output);
+}
+
+static void capacity_output_packet(void *data, struct encoder_packet *packet)
+{
+	auto co = (capacity_output *)data;
+	if (!packet) {
+		co->failed = true;
+		return;
+	}
+	co->packets++;
+}
+
+void CapacityBenchmark::RegisterOutput()
+{
+	struct obs_output_info info = {};
+	info.id = CAPACITY_OUTPUT_ID;
+	info.flags = OBS_OUTPUT_VIDEO | OBS_OUTPUT_ENCODED;
+	info.get_name = capacity_output_name;
+	info.create = capacity_output_create;
+	info.destroy = capacity_output_destroy;
+	info.start = capacity_output_start;
+	info.stop = capacity_output_stop;
+	info.encoded_packet = capacity_output_packet;
+	obs_register_output(&info);
+}
+
+// Feeds NV12 frames at the video output frame rate, a textured pattern that moves every frame so encoders cannot skip work
+struct capacity_frames {
+	video_t *video;
+	uint32_t width;
+	uint32_t height;
+	uint64_t interval;
+	std::thread thread;
+	std::atomic<bool> stop = false;
+	std::atomic<uint64_t> pushed = 0;
+	std::atomic<uint64_t> dropped = 0;
+
+	void Run()
+	{
+		os_set_thread_name("aitum-multistream-capacity-frames");
+		std::mt19937 rng(width * 31 + height);
+		std::vector<uint8_t> pattern((size_t)width * height + 64);
+		for (size_t i = 0; i < pattern.size(); i++) {
+			size_t x = i % width;
+			size_t y = i / width;
+			pattern[i] = (uint8_t)((x * 191 / width + y * 191 / (height + 1)) / 2 + rng() % 64);
+		}
+		uint64_t next = os_gettime_ns();
+		for (uint64_t n = 0; !stop; n++) {
+			os_sleepto_ns(next);
+			struct video_frame frame;
+			if (video_output_lock_frame(video, &frame, 1, next)) {
+				for (uint32_t y = 0; y < height; y++)
+					memcpy(frame.data[0] + (size_t)y * frame.linesize[0],
+					       pattern.data() + (size_t)((y + n * 2) % height) * width + n % 64, width);
+				for (uint32_t y = 0; y < height / 2; y++)
+					memcpy(frame.data[1] + (size_t)y * frame.linesize[1],
+					       pattern.data() + (size_t)((y * 2 + n) % height) * width + (n * 3) % 64, width);
+				video_output_unlock_frame(video);
+				pushed++;
+			} else {
+				dropped++;
+			}
+			next += interval;
+		}
+	}
+};
+
+static bool capacity_same_run(const encoder_workload &run, const std::string &encoder_id, const std::string &preset,
+			      const encoder_workload &size)
+{
+	return run.encoder_id == encoder_id && run.preset == preset && run.width == size.width && run.height == size.height &&
+	       run.divisor == size.divisor;
+}
+
+CapacityBenchmark::CapacityBenchmark(std::vector<encoder_workload> workloads_, int durationSeconds_, progress_cb progress_,
+				     std::function<void()> finished_)
+	: workloads(workloads_),
+	  durationSeconds(durationSeconds_),
+	  progress(progress_),
+	  finished(finished_)
+{
+	thread = std::thread(&CapacityBenchmark::Run, this);
+}
+
+CapacityBenchmark::~CapacityBenchmark()
+{
+	Abort();
+	if (thread.joinable())
+		thread.join();
+}
+
+void CapacityBenchmark::Abort()
+{
+	aborted = true;
+}
+
+bool CapacityBenchmark::Wait(uint64_t ms)
+{
+	for (uint64_t waited = 0; waited < ms && !aborted; waited += 50)
+		os_sleep_ms(50);
+	return !aborted;
+}
+
+void CapacityBenchmark::Run()
+{
+	os_set_thread_name("aitum-multistream-capacity-benchmark");
+
+	// Every software encoder at every configured size and divisor, the configured encoders with their own settings.
+	// Outputs sharing encoder, preset, size and divisor are measured once.
+	std::vector<encoder_workload> runs;
+	for (auto &w : workloads) {
+		bool found = false;
+		for (auto &r : runs)
+			found = found || capacity_same_run(r, w.encoder_id, w.preset, w);
+		if (!found)
+			runs.push_back(w);
+	}
+	const char *type;
+	size_t idx = 0;
+	while (obs_enum_encoder_types(idx++, &type)) {
+		if (obs_get_encoder_type(type) != OBS_ENCODER_VIDEO)
+			continue;
+		uint32_t caps = obs_get_encoder_caps(type);
+		if ((caps & (OBS_ENCODER_CAP_DEPRECATED | OBS_ENCODER_CAP_INTERNAL | OBS_ENCODER_CAP_PASS_TEXTURE)) != 0)
+			continue;
+		const char *codec = obs_get_encoder_codec(type);
+		if (astrcmpi(codec, "h264") != 0 && astrcmpi(codec, "hevc") != 0 && astrcmpi(codec, "av1") != 0)
+			continue;
+		auto preset = capacity_encoder_preset(type, nullptr);
+		for (auto &w : workloads) {
+			bool found = false;
+			for (auto &r : runs)
+				found = found || capacity_same_run(r, type, preset, w);
+			if (found)
+				continue;
+			encoder_workload run;
+			run.name = obs_encoder_get_display_name(type);
+			run.encoder_id = type;
+			run.preset = preset;
+			run.width = w.width;
+			run.height = w.height;
+			run.divisor = w.divisor;
+			runs.push_back(run);
+		}
+	}
+	// Hardware encoders are not benchmarked
+	for (auto it = runs.begin(); it != runs.end();) {
+		if ((obs_get_encoder_caps(it->encoder_id.c_str()) & OBS_ENCODER_CAP_PASS_TEXTURE) != 0)
+			it = runs.erase(it);
+		else
+			it++;
+	}
+
+	auto costs = obs_data_array_create();
+	if (runs.empty())
+		progress("Capacity benchmark: no software encoder configured");
+	for (size_t i = 0; i < runs.size() && !aborted; i++) {
+		progress("Capacity benchmark " + std::to_string(i + 1) + "/" + std::to_string(runs.size()) + ": " +
+			 runs[i].encoder_id + " " + runs[i].preset + " " + std::to_string(runs[i].width) + "x" +
+			 std::to_string(runs[i].height) + " divisor " + std::to_string(runs[i].divisor));
+		if (!RunWorkload(runs[i], costs))
+			break;
+	}
+
+	// Merge with earlier measurements, the new ones replace the same encoder, preset, size and frame rate
+	auto results = capacity_load_costs();
+	auto old_costs = obs_data_get_array(results, "costs");
+	size_t new_count = obs_data_array_count(costs);
+	size_t old_count = obs_data_array_count(old_costs);
+	for (size_t i = 0; i < old_count; i++) {
+		auto old_cost = obs_data_array_item(old_costs, i);
+		bool replaced = false;
+		for (size_t j = 0; j < new_count && !replaced; j++) {
+			auto cost = obs_data_array_item(costs, j);
+			replaced = strcmp(obs_data_get_string(cost, "encoder"), obs_data_get_string(old_cost, "encoder")) == 0 &&
+				   strcmp(obs_data_get_string(cost, "preset"), obs_data_get_string(old_cost, "preset")) == 0 &&
+				   obs_data_get_int(cost, "width") == obs_data_get_int(old_cost, "width") &&
+				   obs_data_get_int(cost, "height") == obs_data_get_int(old_cost, "height") &&
+				   std::fabs(obs_data_get_double(cost, "fps") - obs_data_get_double(old_cost, "fps")) < 0.01;
+			obs_data_release(cost);
+		}
+		if (!replaced)
+			obs_data_array_push_back(costs, old_cost);
+		obs_data_release(old_cost);
+	}
+	obs_data_array_release(old_costs);
+	obs_data_set_int(results, "timestamp", (long long)time(nullptr));
+	obs_data_set_int(results, "duration", durationSeconds);
+	obs_data_set_array(results, "costs", costs);
+	obs_data_array_release(costs);
+	char *path = obs_module_config_path("encoder-costs.json");
+	if (path) {
+		if (obs_data_save_json_safe(results, path, "tmp", "bak"))
+			progress(std::string("Capacity benchmark: results saved to ") + path);
+		bfree(path);
+	}
+	obs_data_release(results);
+	if (aborted)
+		progress("Capacity benchmark: aborted");
+	running = false;
+	finished();
+}
+
+bool CapacityBenchmark::RunWorkload(const encoder_workload &workload, obs_data_array_t *costs)
+{
+	struct obs_video_info ovi;
+	if (!obs_get_video_info(&ovi) || !ovi.fps_num || !workload.width || !workload.height)
+		return true;
+
+	struct video_output_info voi = {};
+	voi.name = "aitum_multistream_capacity";
+	voi.format = VIDEO_FORMAT_NV12;
+	voi.fps_num = ovi.fps_num;
+	voi.fps_den = ovi.fps_den * workload.divisor;
+	voi.width = workload.width & ~1u;
+	voi.height = workload.height & ~1u;
+	voi.cache_size = 16;
+	voi.colorspace = VIDEO_CS_709;
+	voi.range = VIDEO_RANGE_PARTIAL;
+	video_t *video = nullptr;
+	if (video_output_open(&video, &voi) != VIDEO_OUTPUT_SUCCESS) {
+		progress("  failed to open video output");
+		return true;
+	}
+
+	auto settings = workload.settings_json.empty() ? obs_data_create()
+						       : obs_data_create_from_json(workload.settings_json.c_str());
+	auto encoder = obs_video_encoder_create(workload.encoder_id.c_str(), "aitum_multistream_capacity_video", settings,
+						nullptr);
+	obs_data_release(settings);
+	auto output = encoder ? obs_output_create(CAPACITY_OUTPUT_ID, "aitum_multistream_capacity", nullptr, nullptr) : nullptr;
+	if (!output) {
+		progress("  failed to create encoder");
+		obs_encoder_release(encoder);
+		video_output_close(video);
+		return true;
+	}
+	obs_encoder_set_video(encoder, video);
+	obs_output_set_video_encoder(output, encoder);
+
+	auto frames = new capacity_frames;
+	frames->video = video;
+	frames->width = voi.width;
+	frames->height = voi.height;
+	frames->interval = 1000000000ULL * voi.fps_den / voi.fps_num;
+	frames->thread = std::thread(&capacity_frames::Run, frames);
+
+	// Baseline with the frames flowing but nothing encoding them
+	auto cpu_info = os_cpu_usage_info_start();
+	bool completed = Wait((uint64_t)durationSeconds * 1000);
+	double baseline = os_cpu_usage_info_query(cpu_info);
+
+	auto co = (capacity_output *)obs_obj_get_data(output);
+	double cpu = 0.0;
+	uint64_t pushed = 0;
+	uint64_t packets = 0;
+	uint64_t dropped = 0;
+	bool started = completed && obs_output_start(output);
+	bool failed = false;
+	if (!completed) {
+	} else if (!started) {
+		progress("  failed to start encoder");
+	} else if ((completed = Wait(CAPACITY_WARMUP_MS))) {
+		os_cpu_usage_info_query(cpu_info);
+		pushed = frames->pushed;
+		packets = co->packets;
+		dropped = frames->dropped + video_output_get_skipped_frames(video);
+		completed = Wait((uint64_t)durationSeconds * 1000);
+		cpu = os_cpu_usage_info_query(cpu_info) - baseline;
+		pushed = frames->pushed - pushed;
+		packets = co->packets - packets;
+		dropped = frames->dropped + video_output_get_skipped_frames(video) - dropped;
+		failed = co->failed;
+	}
+	os_cpu_usage_info_destroy(cpu_info);
+
+	if (started) {
+		obs_output_stop(output);
+		for (uint64_t waited = 0; waited < 5000 && obs_output_active(output); waited += 50)
+			os_sleep_ms(50);
+		if (obs_output_active(output))
+			obs_output_force_stop(output);
+	}
+	obs_output_release(output);
+	obs_encoder_release(encoder);
+	frames->stop = true;
+	frames->thread.join();
+	delete frames;
+	video_output_close(video);
+
+	if (!completed || !started)
+		return completed;
+
+	const bool lagging = failed || (double)packets < (double)pushed * CAPACITY_KEEP_UP_RATIO ||
+			     (double)pushed < (double)(pushed + dropped) * CAPACITY_KEEP_UP_RATIO;
+	if (cpu < 0.0)
+		cpu = 0.0;
+	auto cost = obs_data_create();
+	obs_data_set_string(cost, "encoder", workload.encoder_id.c_str());
+	obs_data_set_string(cost, "preset", workload.preset.c_str());
+	obs_data_set_int(cost, "width", voi.width);
+	obs_data_set_int(cost, "height", voi.height);
+	obs_data_set_int(cost, "divisor", workload.divisor);
+	obs_data_set_double(cost, "fps", (double)voi.fps_num / (double)voi.fps_den);
+	obs_data_set_double(cost, "cpu", cpu);
+	obs_data_set_double(cost, "baseline_cpu", baseline);
+	obs_data_set_int(cost, "frames", (long long)pushed);
+	obs_data_set_int(cost, "packets", (long long)packets);
+	obs_data_set_int(cost, "dropped_frames", (long long)dropped);
+	obs_data_set_bool(cost, "lagging", lagging);
+	obs_data_array_push_back(costs, cost);
+	obs_data_release(cost);
+	progress("  cpu " + std::to_string((int)std::lround(cpu)) + "%, encoded " + std::to_string(packets) + "/" +
+		 std::to_string(pushed + dropped) + " frames" + (lagging ? ", not keeping up" : ""));
+	return true;
+}
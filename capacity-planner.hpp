@@ -0,0 +1,69 @@
+#pragma once
+
+#include <obs.h>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Predicted encoder load above this share of the CPU leaves too little for OBS itself
+#define CAPACITY_CPU_LIMIT 80
+
+// One video encoder as configured on an output, the unit the cost model is keyed on
+struct encoder_workload {
+	std::string name;
+	std::string encoder_id;
+	std::string preset;
+	std::string settings_json;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t divisor = 1;
+};
+
+struct capacity_estimate {
+	double cpu = 0.0;
+	bool known = false;
+	bool measured = false;
+	bool lagging = false;
+	bool hardware = false;
+};
+
+// Fills a workload from output settings, false when the output reuses the canvas encoder
+bool capacity_workload_from_settings(obs_data_t *settings, bool vertical, encoder_workload &workload);
+
+// Loads encoder-costs.json, the caller releases the result
+obs_data_t *capacity_load_costs();
+
+// Cost of a workload as percentage of the total CPU, measured or scaled by pixel rate from the closest measurement
+capacity_estimate capacity_estimate_workload(obs_data_t *costs, const encoder_workload &workload);
+
+// Encodes synthetic frames from a private video output with every available software encoder at the configured sizes
+// and frame rate divisors, and measures the CPU time it adds to the process. Runs on its own thread, results are merged
+// into encoder-costs.json.
+class CapacityBenchmark {
+public:
+	typedef std::function<void(const std::string &line)> progress_cb;
+
+	CapacityBenchmark(std::vector<encoder_workload> workloads, int durationSeconds, progress_cb progress,
+			  std::function<void()> finished);
+	~CapacityBenchmark();
+
+	bool Running() const { return running; }
+	void Abort();
+
+	static void RegisterOutput();
+
+private:
+	std::vector<encoder_workload> workloads;
+	int durationSeconds;
+	progress_cb progress;
+	std::function<void()> finished;
+	std::thread thread;
+	std::atomic<bool> running = true;
+	std::atomic<bool> aborted = false;
+
+	void Run();
+	bool RunWorkload(const encoder_workload &workload, obs_data_array_t *costs);
+	bool Wait(uint64_t ms);
+};
@@ -19,9 +19,13 @@
 #include <QCompleter>
 #include <QDesktopServices>
 #include <QUrl>
+#include <QUuid>
 #include <QIcon>
 #include <QTabWidget>
 #include <QDialogButtonBox>
+#include <QHeaderView>
+#include <QTableView>
+#include <QTimer>
 
 #include "obs-module.h"
 #include "version.h"
@@ -32,18 +36,15 @@
 #include <util/config-file.h>
 #include "output-dialog.hpp"
 #include "config-utils.hpp"
+#include "multistream.hpp"
+#include "loopback-test.hpp"
+#include "output-scheduler.hpp"
+#include "settings-diff.hpp"
+#include "topology-model.hpp"
+#include "trace.hpp"
 
-#ifndef _WIN32
-#include <dlfcn.h>
-#endif
-
-template<typename T> std::string to_string_with_precision(const T a_value, const int n = 6)
-{
-	std::ostringstream out;
-	out.precision(n);
-	out << std::fixed << a_value;
-	return std::move(out).str();
-}
+// Seconds per measurement, every encoder run measures a baseline and a loaded period
+#define CAPACITY_BENCHMARK_SECONDS 5
 
 void RemoveWidget(QWidget *widget);
 void RemoveLayoutItem(QLayoutItem *item);
@@ -79,7 +80,6 @@ OBSBasicSettings::OBSBasicSettings(QMainWindow *parent) : QDialog(parent)
 	listwidgetitem = new QListWidgetItem(listWidget);
 	listwidgetitem->setIcon(main_window->property("defaultIcon").value<QIcon>());
 	listwidgetitem->setText(QString::fromUtf8(obs_module_text("SetupTroubleshooter")));
-	listwidgetitem->setHidden(true);
 
 	listwidgetitem = new QListWidgetItem(listWidget);
 	listwidgetitem->setIcon(main_window->property("defaultIcon").value<QIcon>());
@@ -165,15 +165,140 @@ OBSBasicSettings::OBSBasicSettings(QMainWindow *parent) : QDialog(parent)
 	scrollArea->setFrameShape(QFrame::NoFrame);
 	settingsPages->addWidget(scrollArea);
 
+	auto troubleshooterPage = new QWidget;
+	auto troubleshooterPageLayout = new QVBoxLayout;
+	troubleshooterPageLayout->setContentsMargins(0, 0, 0, 0);
+	troubleshooterPage->setLayout(troubleshooterPageLayout);
+
+	topologyModel = new TopologyModel(this);
+	auto topologyView = new QTableView;
+	topologyView->setModel(topologyModel);
+	topologyView->setSelectionBehavior(QAbstractItemView::SelectRows);
+	topologyView->setWordWrap(false);
+	topologyView->verticalHeader()->setVisible(false);
+	topologyView->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+	topologyView->horizontalHeader()->setStretchLastSection(true);
+	troubleshooterPageLayout->addWidget(topologyView, 2);
+
+	// Live while the troubleshooter is on screen, the collection runs off the UI thread
+	auto topologyTimer = new QTimer(this);
+	connect(topologyTimer, &QTimer::timeout, [this, topologyView] {
+		if (topologyView->isVisible())
+			topologyModel->Refresh();
+	});
+	topologyTimer->start(1000);
+
 	troubleshooterText = new QTextEdit;
 	troubleshooterText->setReadOnly(true);
+	troubleshooterPageLayout->addWidget(troubleshooterText, 1);
+
+	auto loopbackLayout = new QHBoxLayout;
+	loopbackLayout->addWidget(new QLabel(QString::fromUtf8(obs_module_text("LoopbackTestOutputs"))));
+	auto loopbackOutputs = new QSpinBox;
+	loopbackOutputs->setRange(1, 64);
+	loopbackOutputs->setValue(8);
+	loopbackLayout->addWidget(loopbackOutputs);
+	loopbackLayout->addWidget(new QLabel(QString::fromUtf8(obs_module_text("LoopbackTestDuration"))));
+	auto loopbackDuration = new QSpinBox;
+	loopbackDuration->setRange(5, 300);
+	loopbackDuration->setValue(10);
+	loopbackDuration->setSuffix(QString::fromUtf8(" s"));
+	loopbackLayout->addWidget(loopbackDuration);
+	loopbackLayout->addStretch(1);
+	loopbackButton = new QPushButton(QString::fromUtf8(obs_module_text("LoopbackTestRun")));
+	loopbackButton->setToolTip(QString::fromUtf8(obs_module_text("LoopbackTestInfo")));
+	connect(loopbackButton, &QPushButton::clicked, [this, loopbackOutputs, loopbackDuration] {
+		if (loopbackTest)
+			return;
+		loopbackButton->setEnabled(false);
+		troubleshooterText->append(QString::fromUtf8(""));
+		std::string resultsPath;
+		char *path = obs_module_config_path("loopback-test.json");
+		if (path) {
+			resultsPath = path;
+			bfree(path);
+		}
+		loopbackTest = new LoopbackTest(
+			obs_get_video(), obs_get_audio(), loopbackOutputs->value(), loopbackDuration->value(), resultsPath, "",
+			[this](const std::string &line) {
+				blog(LOG_INFO, "[Aitum Multistream] %s", line.c_str());
+				auto text = QString::fromUtf8(line.c_str());
+				QMetaObject::invokeMethod(
+					this, [this, text] { troubleshooterText->append(text); }, Qt::QueuedConnection);
+			},
+			[this] {
+				QMetaObject::invokeMethod(
+					this,
+					[this] {
+						delete loopbackTest;
+						loopbackTest = nullptr;
+						loopbackButton->setEnabled(true);
+					},
+					Qt::QueuedConnection);
+			});
+	});
+	loopbackLayout->addWidget(loopbackButton);
+	capacityButton = new QPushButton(QString::fromUtf8(obs_module_text("EncoderBenchmarkRun")));
+	capacityButton->setToolTip(QString::fromUtf8(obs_module_text("EncoderBenchmarkInfo")));
+	connect(capacityButton, &QPushButton::clicked, [this] {
+		if (capacityBenchmark)
+			return;
+		capacityButton->setEnabled(false);
+		troubleshooterText->append(QString::fromUtf8(""));
+		capacityBenchmark = new CapacityBenchmark(
+			CapacityWorkloads(), CAPACITY_BENCHMARK_SECONDS,
+			[this](const std::string &line) {
+				blog(LOG_INFO, "[Aitum Multistream] %s", line.c_str());
+				auto text = QString::fromUtf8(line.c_str());
+				QMetaObject::invokeMethod(
+					this, [this, text] { troubleshooterText->append(text); }, Qt::QueuedConnection);
+			},
+			[this] {
+				QMetaObject::invokeMethod(
+					this,
+					[this] {
+						delete capacityBenchmark;
+						capacityBenchmark = nullptr;
+						capacityButton->setEnabled(true);
+						obs_data_release(encoder_costs);
+						encoder_costs = capacity_load_costs();
+						UpdateCapacity();
+					},
+					Qt::QueuedConnection);
+			});
+	});
+	loopbackLayout->addWidget(capacityButton);
+	auto traceButton = new QPushButton(QString::fromUtf8(obs_module_text("TraceExport")));
+	traceButton->setToolTip(QString::fromUtf8(obs_module_text("TraceExportInfo")));
+	connect(traceButton, &QPushButton::clicked, [this] {
+		char *default_path = obs_module_config_path("trace.json");
+		auto path = QFileDialog::getSaveFileName(this, QString::fromUtf8(obs_module_text("TraceExport")),
+							 QString::fromUtf8(default_path ? default_path : ""),
+							 QString::fromUtf8("JSON (*.json)"));
+		bfree(default_path);
+		if (path.isEmpty())
+			return;
+		auto count = trace_export_chrome(path.toUtf8().constData());
+		troubleshooterText->append(count < 0 ? QString::fromUtf8(obs_module_text("TraceExportFailed")).arg(path)
+						     : QString::fromUtf8(obs_module_text("TraceExported")).arg(count).arg(path));
+	});
+	loopbackLayout->addWidget(traceButton);
+	auto topologyButton = new QPushButton(QString::fromUtf8(obs_module_text("TopologyExport")));
+	connect(topologyButton, &QPushButton::clicked, [this] {
+		char *default_path = obs_module_config_path("topology.json");
+		auto path = QFileDialog::getSaveFileName(this, QString::fromUtf8(obs_module_text("TopologyExport")),
+							 QString::fromUtf8(default_path ? default_path : ""),
+							 QString::fromUtf8("JSON (*.json)"));
+		bfree(default_path);
+		if (path.isEmpty())
+			return;
+		if (!topologyModel->ExportJson(path.toUtf8().constData()))
+			troubleshooterText->append(QString::fromUtf8(obs_module_text("TopologyExportFailed")).arg(path));
+	});
+	loopbackLayout->addWidget(topologyButton);
+	troubleshooterPageLayout->addLayout(loopbackLayout);
 
-	scrollArea = new QScrollArea;
-	scrollArea->setWidget(troubleshooterText);
-	scrollArea->setWidgetResizable(true);
-	scrollArea->setLineWidth(0);
-	scrollArea->setFrameShape(QFrame::NoFrame);
-	settingsPages->addWidget(scrollArea);
+	settingsPages->addWidget(troubleshooterPage);
 
 	// Help page
 	auto helpPage = new QWidget;
@@ -246,6 +371,7 @@ OBSBasicSettings::OBSBasicSettings(QMainWindow *parent) : QDialog(parent)
 			auto s = obs_data_create();
 
 			// Set the info from the output dialog
+			obs_data_set_string(s, "id", QUuid::createUuid().toString(QUuid::WithoutBraces).toUtf8().constData());
 			obs_data_set_string(s, "name", outputDialog->outputName.toUtf8().constData());
 			obs_data_set_string(s, "stream_server", outputDialog->outputServer.toUtf8().constData());
 			obs_data_set_string(s, "stream_key", outputDialog->outputKey.toUtf8().constData());
@@ -282,6 +408,58 @@ OBSBasicSettings::OBSBasicSettings(QMainWindow *parent) : QDialog(parent)
 	//	mainTitle->setStyleSheet(QString::fromUtf8("font-weight: bold;"));
 	serverLayout->addRow(mainDescription);
 
+	preflightProbeCheckbox = new QCheckBox(QString::fromUtf8(obs_module_text("PreflightProbe")));
+	connect(preflightProbeCheckbox, &QCheckBox::toggled, [this] {
+		if (main_settings)
+			obs_data_set_bool(main_settings, "preflight_probe", preflightProbeCheckbox->isChecked());
+	});
+	serverLayout->addRow(preflightProbeCheckbox);
+
+	resumeLiveOutputsCheckbox = new QCheckBox(QString::fromUtf8(obs_module_text("ResumeLiveOutputs")));
+	resumeLiveOutputsCheckbox->setToolTip(QString::fromUtf8(obs_module_text("ResumeLiveOutputsInfo")));
+	connect(resumeLiveOutputsCheckbox, &QCheckBox::toggled, [this] {
+		if (main_settings)
+			obs_data_set_bool(main_settings, "resume_live_outputs", resumeLiveOutputsCheckbox->isChecked());
+	});
+	serverLayout->addRow(resumeLiveOutputsCheckbox);
+
+	auto uploadBudgetLayout = new QHBoxLayout;
+	uploadBudget = new QSpinBox;
+	uploadBudget->setRange(0, 10000000);
+	uploadBudget->setSingleStep(500);
+	uploadBudget->setSuffix(QString::fromUtf8(" Kbps"));
+	uploadBudget->setSpecialValueText(QString::fromUtf8(obs_frontend_get_locale_string("Off")));
+	uploadBudget->setToolTip(QString::fromUtf8(obs_module_text("UploadBudgetInfo")));
+	connect(uploadBudget, &QSpinBox::valueChanged, [this] {
+		if (main_settings)
+			obs_data_set_int(main_settings, "upload_budget", uploadBudget->value());
+	});
+	uploadBudgetLayout->addWidget(uploadBudget, 1);
+	uploadBudgetMode = new QComboBox;
+	uploadBudgetMode->addItem(QString::fromUtf8(obs_module_text("UploadBudgetWarn")), UPLOAD_BUDGET_WARN);
+	uploadBudgetMode->addItem(QString::fromUtf8(obs_module_text("UploadBudgetRefuse")), UPLOAD_BUDGET_REFUSE);
+	connect(uploadBudgetMode, &QComboBox::currentIndexChanged, [this] {
+		if (main_settings)
+			obs_data_set_int(main_settings, "upload_budget_mode", uploadBudgetMode->currentData().toInt());
+	});
+	uploadBudgetLayout->addWidget(uploadBudgetMode);
+	serverLayout->addRow(QString::fromUtf8(obs_module_text("UploadBudget")), uploadBudgetLayout);
+
+	scheduleLead = new QSpinBox;
+	scheduleLead->setRange(0, 600);
+	scheduleLead->setSuffix(QString::fromUtf8(" s"));
+	scheduleLead->setToolTip(QString::fromUtf8(obs_module_text("ScheduleLeadInfo")));
+	connect(scheduleLead, &QSpinBox::valueChanged, [this] {
+		if (main_settings)
+			obs_data_set_int(main_settings, "schedule_lead", scheduleLead->value());
+	});
+	serverLayout->addRow(QString::fromUtf8(obs_module_text("ScheduleLead")), scheduleLead);
+
+	encoder_costs = capacity_load_costs();
+	capacityLabel = new QLabel;
+	capacityLabel->setWordWrap(true);
+	serverLayout->addRow(QString::fromUtf8(obs_module_text("EncoderCapacity")), capacityLabel);
+
 	serverGroup->setLayout(serverLayout);
 
 	mainOutputsLayout->addRow(serverGroup);
@@ -423,6 +601,9 @@ OBSBasicSettings::OBSBasicSettings(QMainWindow *parent) : QDialog(parent)
 
 OBSBasicSettings::~OBSBasicSettings()
 {
+	delete loopbackTest;
+	delete capacityBenchmark;
+	obs_data_release(encoder_costs);
 	if (vertical_outputs)
 		obs_data_array_release(vertical_outputs);
 	for (auto it = video_encoder_properties.begin(); it != video_encoder_properties.end(); it++)
@@ -616,6 +797,7 @@ void OBSBasicSettings::AddServer(QFormLayout *outputsLayout, obs_data_t *setting
 
 	bool allEmpty = false;
 	QComboBox *videoEncoderIndex = nullptr;
+	QWidget *videoRenditions = nullptr;
 	if (main) {
 		videoEncoderIndex = new QComboBox;
 		for (int i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
@@ -640,6 +822,30 @@ void OBSBasicSettings::AddServer(QFormLayout *outputsLayout, obs_data_t *setting
 		if (videoEncoderIndex->currentIndex() <= 0 &&
 		    !config_get_bool(obs_frontend_get_profile_config(), "Stream1", "EnableMultitrackVideo"))
 			videoPageLayout->setRowVisible(videoEncoderIndex, false);
+
+		// Extra renditions from the main encoders, sent as enhanced RTMP multitrack video
+		videoRenditions = new QWidget;
+		auto videoRenditionsLayout = new QHBoxLayout;
+		videoRenditionsLayout->setContentsMargins(0, 0, 0, 0);
+		videoRenditions->setLayout(videoRenditionsLayout);
+		for (int i = 0; i < videoEncoderIndex->count(); i++) {
+			auto rendition = new QCheckBox(QString::number(i + 1));
+			rendition->setToolTip(videoEncoderIndex->itemText(i));
+			rendition->setChecked((obs_data_get_int(settings, "video_encoder_indexes") & (1LL << i)) != 0);
+			connect(rendition, &QCheckBox::toggled, [rendition, settings, i] {
+				auto indexes = obs_data_get_int(settings, "video_encoder_indexes");
+				if (rendition->isChecked())
+					indexes |= 1LL << i;
+				else
+					indexes &= ~(1LL << i);
+				obs_data_set_int(settings, "video_encoder_indexes", indexes);
+			});
+			videoRenditionsLayout->addWidget(rendition);
+		}
+		videoRenditionsLayout->addStretch(1);
+		videoPageLayout->addRow(QString::fromUtf8(obs_module_text("VideoRenditions")), videoRenditions);
+		videoPageLayout->setRowVisible(videoRenditions, config_get_bool(obs_frontend_get_profile_config(), "Stream1",
+											"EnableMultitrackVideo"));
 	}
 
 	auto videoEncoderGroup = new QWidget();
@@ -664,8 +870,10 @@ void OBSBasicSettings::AddServer(QFormLayout *outputsLayout, obs_data_t *setting
 			}
 		}
 	}
-	connect(fpsDivisor, &QComboBox::currentIndexChanged,
-		[fpsDivisor, settings] { obs_data_set_int(settings, "frame_rate_divisor", fpsDivisor->currentData().toInt()); });
+	connect(fpsDivisor, &QComboBox::currentIndexChanged, [this, fpsDivisor, settings] {
+		obs_data_set_int(settings, "frame_rate_divisor", fpsDivisor->currentData().toInt());
+		UpdateCapacity();
+	});
 
 	videoEncoderGroupLayout->addRow(QString::fromUtf8(obs_frontend_get_locale_string("Basic.Settings.Video.FPS")), fpsDivisor);
 	//obs_encoder_get_frame_rate_divisor
@@ -674,7 +882,10 @@ void OBSBasicSettings::AddServer(QFormLayout *outputsLayout, obs_data_t *setting
 	scale->setCheckable(true);
 	scale->setChecked(obs_data_get_bool(settings, "scale"));
 
-	connect(scale, &QGroupBox::toggled, [scale, settings] { obs_data_set_bool(settings, "scale", scale->isChecked()); });
+	connect(scale, &QGroupBox::toggled, [this, scale, settings] {
+		obs_data_set_bool(settings, "scale", scale->isChecked());
+		UpdateCapacity();
+	});
 
 	auto scaleLayout = new QFormLayout();
 	scale->setLayout(scaleLayout);
@@ -724,12 +935,13 @@ void OBSBasicSettings::AddServer(QFormLayout *outputsLayout, obs_data_t *setting
 	if (resolution->currentText() == "0x0")
 		resolution->setCurrentText(QString::number(ovi.output_width) + "x" + QString::number(ovi.output_height));
 
-	connect(resolution, &QComboBox::currentTextChanged, [settings, resolution] {
+	connect(resolution, &QComboBox::currentTextChanged, [this, settings, resolution] {
 		const auto res = resolution->currentText();
 		uint32_t width, height;
 		if (sscanf(res.toUtf8().constData(), "%dx%d", &width, &height) == 2 && width > 0 && height > 0) {
 			obs_data_set_int(settings, "width", width);
 			obs_data_set_int(settings, "height", height);
+			UpdateCapacity();
 		}
 	});
 
@@ -737,9 +949,41 @@ void OBSBasicSettings::AddServer(QFormLayout *outputsLayout, obs_data_t *setting
 
 	videoEncoderGroupLayout->addRow(scale);
 
+	auto abrGroup = new QGroupBox(QString::fromUtf8(obs_module_text("AdaptiveBitrate")));
+	abrGroup->setCheckable(true);
+	abrGroup->setChecked(obs_data_get_bool(settings, "abr"));
+	abrGroup->setToolTip(QString::fromUtf8(obs_module_text("AdaptiveBitrateInfo")));
+
+	connect(abrGroup, &QGroupBox::toggled, [abrGroup, settings] { obs_data_set_bool(settings, "abr", abrGroup->isChecked()); });
+
+	auto abrLayout = new QFormLayout();
+	abrGroup->setLayout(abrLayout);
+
+	auto abrMinBitrate = new QSpinBox;
+	abrMinBitrate->setRange(0, 1000000);
+	abrMinBitrate->setSingleStep(50);
+	abrMinBitrate->setSuffix(QString::fromUtf8(" Kbps"));
+	abrMinBitrate->setSpecialValueText(QString::fromUtf8(obs_module_text("Auto")));
+	abrMinBitrate->setValue((int)obs_data_get_int(settings, "abr_min_bitrate"));
+	connect(abrMinBitrate, &QSpinBox::valueChanged,
+		[abrMinBitrate, settings] { obs_data_set_int(settings, "abr_min_bitrate", abrMinBitrate->value()); });
+	abrLayout->addRow(QString::fromUtf8(obs_module_text("AdaptiveBitrateMin")), abrMinBitrate);
+
+	auto abrMaxBitrate = new QSpinBox;
+	abrMaxBitrate->setRange(0, 1000000);
+	abrMaxBitrate->setSingleStep(50);
+	abrMaxBitrate->setSuffix(QString::fromUtf8(" Kbps"));
+	abrMaxBitrate->setSpecialValueText(QString::fromUtf8(obs_module_text("Auto")));
+	abrMaxBitrate->setValue((int)obs_data_get_int(settings, "abr_max_bitrate"));
+	connect(abrMaxBitrate, &QSpinBox::valueChanged,
+		[abrMaxBitrate, settings] { obs_data_set_int(settings, "abr_max_bitrate", abrMaxBitrate->value()); });
+	abrLayout->addRow(QString::fromUtf8(obs_module_text("AdaptiveBitrateMax")), abrMaxBitrate);
+
+	videoPageLayout->addRow(abrGroup);
+
 	connect(videoEncoder, &QComboBox::currentIndexChanged,
-		[this, serverGroup, advancedGroupLayout, videoPageLayout, videoEncoder, videoEncoderIndex, videoEncoderGroup,
-		 videoEncoderGroupLayout, settings, videoPage, main] {
+		[this, serverGroup, advancedGroupLayout, videoPageLayout, videoEncoder, videoEncoderIndex, videoRenditions,
+		 videoEncoderGroup, videoEncoderGroupLayout, abrGroup, settings, videoPage, main] {
 			auto encoder_string = videoEncoder->currentData().toString().toUtf8();
 			auto encoder = encoder_string.constData();
 			const bool encoder_changed = strcmp(obs_data_get_string(settings, "video_encoder"), encoder) != 0;
@@ -749,17 +993,23 @@ void OBSBasicSettings::AddServer(QFormLayout *outputsLayout, obs_data_t *setting
 				if (!videoEncoderIndex) {
 				} else if (config_get_bool(obs_frontend_get_profile_config(), "Stream1", "EnableMultitrackVideo")) {
 					videoPageLayout->setRowVisible(videoEncoderIndex, true);
+					videoPageLayout->setRowVisible(videoRenditions, true);
 				} else {
 					videoPageLayout->setRowVisible(videoEncoderIndex, false);
+					videoPageLayout->setRowVisible(videoRenditions, false);
 					if (videoEncoderIndex->currentIndex() != 0)
 						videoEncoderIndex->setCurrentIndex(0);
 				}
 				videoEncoderGroup->setVisible(false);
+				abrGroup->setVisible(false);
 			} else {
-				if (videoEncoderIndex)
+				if (videoEncoderIndex) {
 					videoPageLayout->setRowVisible(videoEncoderIndex, false);
+					videoPageLayout->setRowVisible(videoRenditions, false);
+				}
 				if (!videoEncoderGroup->isVisibleTo(videoPage))
 					videoEncoderGroup->setVisible(true);
+				abrGroup->setVisible((obs_get_encoder_caps(encoder) & OBS_ENCODER_CAP_DYN_BITRATE) != 0);
 				auto t = video_encoder_properties.find(serverGroup);
 				if (t != video_encoder_properties.end()) {
 					obs_properties_destroy(t->second);
@@ -789,6 +1039,7 @@ void OBSBasicSettings::AddServer(QFormLayout *outputsLayout, obs_data_t *setting
 				}
 				obs_data_release(ves);
 			}
+			UpdateCapacity();
 		});
 
 	const char *current_type = obs_data_get_string(settings, "video_encoder");
@@ -807,8 +1058,10 @@ void OBSBasicSettings::AddServer(QFormLayout *outputsLayout, obs_data_t *setting
 		if (strcmp(type, current_type) == 0)
 			videoEncoder->setCurrentIndex(videoEncoder->count() - 1);
 	}
-	if (videoEncoder->currentIndex() <= 0)
+	if (videoEncoder->currentIndex() <= 0) {
 		videoEncoderGroup->setVisible(false);
+		abrGroup->setVisible(false);
+	}
 
 	auto audioEncoder = new QComboBox;
 	audioPageLayout->addRow(QString::fromUtf8(obs_module_text("AudioEncoder")), audioEncoder);
@@ -834,6 +1087,37 @@ void OBSBasicSettings::AddServer(QFormLayout *outputsLayout, obs_data_t *setting
 	});
 	audioPageLayout->addRow(QString::fromUtf8(obs_module_text("AudioTrack")), audioTrack);
 
+	// Extra tracks are the audio encoders the main output already runs, sent over the same connection
+	auto audioTracks = new QWidget;
+	auto audioTracksLayout = new QHBoxLayout;
+	audioTracksLayout->setContentsMargins(0, 0, 0, 0);
+	audioTracks->setLayout(audioTracksLayout);
+	int mainAudioEncoders = 0;
+	auto main_output = main ? obs_frontend_get_streaming_output() : nullptr;
+	for (int i = 0; main_output && i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		auto encoder = obs_output_get_audio_encoder(main_output, (size_t)i);
+		if (!encoder)
+			continue;
+		mainAudioEncoders++;
+		auto track = new QCheckBox(QString::number(i + 1));
+		track->setToolTip(QString::fromUtf8(obs_encoder_get_name(encoder)));
+		track->setChecked((obs_data_get_int(settings, "audio_encoder_indexes") & (1LL << i)) != 0);
+		connect(track, &QCheckBox::toggled, [track, settings, i] {
+			auto indexes = obs_data_get_int(settings, "audio_encoder_indexes");
+			if (track->isChecked())
+				indexes |= 1LL << i;
+			else
+				indexes &= ~(1LL << i);
+			obs_data_set_int(settings, "audio_encoder_indexes", indexes);
+		});
+		audioTracksLayout->addWidget(track);
+	}
+	obs_output_release(main_output);
+	audioTracksLayout->addStretch(1);
+	audioPageLayout->addRow(QString::fromUtf8(obs_module_text("AudioTracks")), audioTracks);
+	// Nothing to add when the main output runs a single audio encoder
+	audioPageLayout->setRowVisible(audioTracks, mainAudioEncoders > 1);
+
 	auto audioEncoderGroup = new QWidget();
 	audioEncoderGroup->setProperty("altColor", QVariant(true));
 	auto audioEncoderGroupLayout = new QFormLayout();
@@ -915,6 +1199,15 @@ void OBSBasicSettings::AddServer(QFormLayout *outputsLayout, obs_data_t *setting
 	// Hook up
 	advancedTabWidget->addTab(videoPage, QString::fromUtf8(obs_module_text("VideoEncoderSettings")));
 	advancedTabWidget->addTab(audioPage, QString::fromUtf8(obs_module_text("AudioEncoderSettings")));
+	if (main) {
+		advancedTabWidget->addTab(StreamPage(settings), QString::fromUtf8(obs_module_text("StreamSettings")));
+		advancedTabWidget->addTab(RecordPage(settings), QString::fromUtf8(obs_module_text("RecordSettings")));
+	}
+	transport t;
+	if (main && transport_from_server(obs_data_get_string(settings, "stream_server"), t) &&
+	    (t.protocol == TRANSPORT_SRT || t.protocol == TRANSPORT_RIST))
+		advancedTabWidget->addTab(TransportPage(settings, t.protocol),
+					  QString::fromUtf8(transport_protocol_name(t.protocol)));
 	advancedGroupLayout->addWidget(advancedTabWidget, 1);
 
 	// Remove button
@@ -935,6 +1228,7 @@ void OBSBasicSettings::AddServer(QFormLayout *outputsLayout, obs_data_t *setting
 			}
 			obs_data_release(item);
 		}
+		UpdateCapacity();
 	});
 
 	// Edit button
@@ -972,7 +1266,7 @@ void OBSBasicSettings::AddServer(QFormLayout *outputsLayout, obs_data_t *setting
 
 			// Reload
 			LoadSettings(main_settings);
-			LoadVerticalSettings(false);
+			LoadVerticalSettings();
 		}
 
 		delete outputDialog;
@@ -985,6 +1279,39 @@ void OBSBasicSettings::AddServer(QFormLayout *outputsLayout, obs_data_t *setting
 
 	serverLayout->addRow(server_title_layout);
 
+	auto groups = new QLineEdit;
+	groups->setText(QString::fromUtf8(obs_data_get_string(settings, "groups")));
+	groups->setToolTip(QString::fromUtf8(obs_module_text("OutputGroupsInfo")));
+	connect(groups, &QLineEdit::textChanged,
+		[groups, settings] { obs_data_set_string(settings, "groups", groups->text().toUtf8().constData()); });
+	serverLayout->addRow(QString::fromUtf8(obs_module_text("OutputGroups")), groups);
+
+	for (auto start : {true, false}) {
+		auto key = start ? "schedule_start" : "schedule_stop";
+		auto schedule = new QLineEdit;
+		schedule->setText(QString::fromUtf8(obs_data_get_string(settings, key)));
+		schedule->setPlaceholderText(QString::fromUtf8(start ? "T+0; mon fri 20:00" : "T+2:00:00"));
+		schedule->setToolTip(QString::fromUtf8(obs_module_text("ScheduleInfo")));
+		connect(schedule, &QLineEdit::textChanged, [schedule, settings, key, start] {
+			auto text = schedule->text().toUtf8();
+			std::vector<schedule_entry> entries;
+			schedule->setStyleSheet(schedule_parse(text.constData(), "", false, start, entries)
+							? QString()
+							: QString::fromUtf8("QLineEdit { border: 1px solid red; }"));
+			obs_data_set_string(settings, key, text.constData());
+		});
+		serverLayout->addRow(QString::fromUtf8(obs_module_text(start ? "ScheduleStart" : "ScheduleStop")), schedule);
+	}
+
+	if (main) {
+		auto followMain = new QCheckBox(QString::fromUtf8(obs_module_text("FollowMain")));
+		followMain->setChecked(obs_data_get_bool(settings, "follow_main"));
+		followMain->setToolTip(QString::fromUtf8(obs_module_text("FollowMainInfo")));
+		connect(followMain, &QCheckBox::toggled,
+			[followMain, settings] { obs_data_set_bool(settings, "follow_main", followMain->isChecked()); });
+		serverLayout->addRow(followMain);
+	}
+
 	serverLayout->addRow(advancedGroup);
 
 	serverGroup->setLayout(serverLayout);
@@ -992,28 +1319,242 @@ void OBSBasicSettings::AddServer(QFormLayout *outputsLayout, obs_data_t *setting
 	outputsLayout->addRow(serverGroup);
 }
 
-void OBSBasicSettings::LoadVerticalSettings(bool load)
+QWidget *OBSBasicSettings::StreamPage(obs_data_t *settings)
+{
+	auto streamPage = new QWidget;
+	streamPage->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+	auto streamPageLayout = new QFormLayout;
+	streamPage->setLayout(streamPageLayout);
+
+	// Unchecked uses the stream delay of the OBS profile
+	auto delayGroup = new QGroupBox(QString::fromUtf8(obs_module_text("StreamDelayCustom")));
+	delayGroup->setCheckable(true);
+	delayGroup->setChecked(obs_data_get_bool(settings, "delay_custom"));
+	connect(delayGroup, &QGroupBox::toggled,
+		[delayGroup, settings] { obs_data_set_bool(settings, "delay_custom", delayGroup->isChecked()); });
+	auto delayLayout = new QFormLayout;
+	delayGroup->setLayout(delayLayout);
+
+	auto delay = new QSpinBox;
+	delay->setRange(0, 3600);
+	delay->setSuffix(QString::fromUtf8(" s"));
+	delay->setSpecialValueText(QString::fromUtf8(obs_frontend_get_locale_string("Off")));
+	delay->setValue((int)obs_data_get_int(settings, "delay_sec"));
+	connect(delay, &QSpinBox::valueChanged, [delay, settings] { obs_data_set_int(settings, "delay_sec", delay->value()); });
+	delayLayout->addRow(QString::fromUtf8(obs_frontend_get_locale_string("Basic.Settings.Advanced.StreamDelay.Duration")),
+			    delay);
+
+	auto delayPreserve = new QCheckBox(
+		QString::fromUtf8(obs_frontend_get_locale_string("Basic.Settings.Advanced.StreamDelay.Preserve")));
+	delayPreserve->setChecked(obs_data_get_bool(settings, "delay_preserve"));
+	connect(delayPreserve, &QCheckBox::toggled,
+		[delayPreserve, settings] { obs_data_set_bool(settings, "delay_preserve", delayPreserve->isChecked()); });
+	delayLayout->addRow(delayPreserve);
+
+	streamPageLayout->addRow(delayGroup);
+
+	auto bindIp = new QComboBox;
+	bindIp->addItem(QString::fromUtf8(obs_module_text("ProfileDefault")), QString::fromUtf8(""));
+	bindIp->addItem(QString::fromUtf8(obs_module_text("BindIpAuto")), QString::fromUtf8("auto"));
+	auto props = obs_get_output_properties("rtmp_output");
+	auto bindIpProperty = obs_properties_get(props, "bind_ip");
+	for (size_t i = 0; i < obs_property_list_item_count(bindIpProperty); i++)
+		bindIp->addItem(QString::fromUtf8(obs_property_list_item_name(bindIpProperty, i)),
+				QString::fromUtf8(obs_property_list_item_string(bindIpProperty, i)));
+	obs_properties_destroy(props);
+	auto bind_ip = QString::fromUtf8(obs_data_get_string(settings, "bind_ip"));
+	if (bindIp->findData(bind_ip) < 0)
+		bindIp->addItem(bind_ip, bind_ip);
+	bindIp->setCurrentIndex(bindIp->findData(bind_ip));
+	bindIp->setToolTip(QString::fromUtf8(obs_module_text("BindIpAutoInfo")));
+	connect(bindIp, &QComboBox::currentIndexChanged, [bindIp, settings] {
+		obs_data_set_string(settings, "bind_ip", bindIp->currentData().toString().toUtf8().constData());
+	});
+	streamPageLayout->addRow(QString::fromUtf8(obs_frontend_get_locale_string("Basic.Settings.Advanced.Network.BindToIP")),
+				 bindIp);
+
+	auto ipFamily = new QComboBox;
+	ipFamily->addItem(QString::fromUtf8(obs_module_text("ProfileDefault")), QString::fromUtf8(""));
+	ipFamily->addItem(QString::fromUtf8(obs_module_text("IpFamilyBoth")), QString::fromUtf8("IPv4+IPv6"));
+	ipFamily->addItem(QString::fromUtf8(obs_module_text("IpFamilyV4")), QString::fromUtf8("IPv4"));
+	ipFamily->addItem(QString::fromUtf8(obs_module_text("IpFamilyV6")), QString::fromUtf8("IPv6"));
+	auto ip_family_index = ipFamily->findData(QString::fromUtf8(obs_data_get_string(settings, "ip_family")));
+	ipFamily->setCurrentIndex(ip_family_index >= 0 ? ip_family_index : 0);
+	connect(ipFamily, &QComboBox::currentIndexChanged, [ipFamily, settings] {
+		obs_data_set_string(settings, "ip_family", ipFamily->currentData().toString().toUtf8().constData());
+	});
+	streamPageLayout->addRow(QString::fromUtf8(obs_module_text("IpFamily")), ipFamily);
+
+	auto priority = new QComboBox;
+	priority->addItem(QString::fromUtf8(obs_module_text("PriorityLow")), -1);
+	priority->addItem(QString::fromUtf8(obs_module_text("PriorityNormal")), 0);
+	priority->addItem(QString::fromUtf8(obs_module_text("PriorityHigh")), 1);
+	auto priority_index = priority->findData((int)obs_data_get_int(settings, "priority"));
+	priority->setCurrentIndex(priority_index >= 0 ? priority_index : 1);
+	priority->setToolTip(QString::fromUtf8(obs_module_text("PriorityInfo")));
+	connect(priority, &QComboBox::currentIndexChanged,
+		[priority, settings] { obs_data_set_int(settings, "priority", priority->currentData().toInt()); });
+	streamPageLayout->addRow(QString::fromUtf8(obs_module_text("Priority")), priority);
+
+	return streamPage;
+}
+
+QWidget *OBSBasicSettings::RecordPage(obs_data_t *settings)
+{
+	auto recordPage = new QWidget;
+	recordPage->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+	auto recordPageLayout = new QFormLayout;
+	recordPage->setLayout(recordPageLayout);
+
+	auto recordMode = new QComboBox;
+	recordMode->addItem(QString::fromUtf8(obs_module_text("RecordModeStream")), RECORD_MODE_STREAM);
+	recordMode->addItem(QString::fromUtf8(obs_module_text("RecordModeStreamAndRecord")), RECORD_MODE_STREAM_AND_RECORD);
+	recordMode->addItem(QString::fromUtf8(obs_module_text("RecordModeRecord")), RECORD_MODE_RECORD);
+	recordMode->setCurrentIndex(recordMode->findData((int)obs_data_get_int(settings, "record_mode")));
+	recordPageLayout->addRow(QString::fromUtf8(obs_module_text("RecordMode")), recordMode);
+
+	auto recordFormat = new QComboBox;
+	recordFormat->addItem(QString::fromUtf8("MP4"), QString::fromUtf8("mp4"));
+	recordFormat->addItem(QString::fromUtf8("Matroska (MKV)"), QString::fromUtf8("mkv"));
+	recordFormat->addItem(QString::fromUtf8("Hybrid MP4"), QString::fromUtf8("hybrid_mp4"));
+	auto format_index = recordFormat->findData(QString::fromUtf8(obs_data_get_string(settings, "record_format")));
+	recordFormat->setCurrentIndex(format_index >= 0 ? format_index : 0);
+	connect(recordFormat, &QComboBox::currentIndexChanged, [recordFormat, settings] {
+		obs_data_set_string(settings, "record_format", recordFormat->currentData().toString().toUtf8().constData());
+	});
+	recordPageLayout->addRow(QString::fromUtf8(obs_module_text("RecordFormat")), recordFormat);
+
+	auto recordPathLayout = new QHBoxLayout;
+	auto recordPath = new QLineEdit;
+	recordPath->setText(QString::fromUtf8(obs_data_get_string(settings, "record_path")));
+	recordPath->setPlaceholderText(QString::fromUtf8(obs_module_text("RecordPathDefault")));
+	connect(recordPath, &QLineEdit::textChanged,
+		[recordPath, settings] { obs_data_set_string(settings, "record_path", recordPath->text().toUtf8().constData()); });
+	recordPathLayout->addWidget(recordPath, 1);
+	auto recordPathButton = new QPushButton(QString::fromUtf8(obs_frontend_get_locale_string("Browse")));
+	connect(recordPathButton, &QPushButton::clicked, [this, recordPath] {
+		auto dir = QFileDialog::getExistingDirectory(this, QString::fromUtf8(obs_module_text("RecordPath")),
+							     recordPath->text(), QFileDialog::ShowDirsOnly);
+		if (!dir.isEmpty())
+			recordPath->setText(dir);
+	});
+	recordPathLayout->addWidget(recordPathButton);
+	recordPageLayout->addRow(QString::fromUtf8(obs_module_text("RecordPath")), recordPathLayout);
+
+	auto updateVisible = [recordPageLayout, recordMode, recordFormat, recordPathLayout] {
+		const bool record = recordMode->currentData().toInt() != RECORD_MODE_STREAM;
+		recordPageLayout->setRowVisible(recordFormat, record);
+		recordPageLayout->setRowVisible(recordPathLayout, record);
+	};
+	updateVisible();
+	connect(recordMode, &QComboBox::currentIndexChanged, [recordMode, settings, updateVisible] {
+		obs_data_set_int(settings, "record_mode", recordMode->currentData().toInt());
+		updateVisible();
+	});
+
+	return recordPage;
+}
+
+QWidget *OBSBasicSettings::TransportPage(obs_data_t *settings, transport_protocol protocol)
+{
+	auto transportPage = new QWidget;
+	transportPage->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+	auto transportPageLayout = new QFormLayout;
+	transportPage->setLayout(transportPageLayout);
+
+	auto latency = new QSpinBox;
+	latency->setRange(0, 60000);
+	latency->setSingleStep(20);
+	latency->setSuffix(QString::fromUtf8(" ms"));
+	latency->setSpecialValueText(QString::fromUtf8(obs_module_text("Auto")));
+	latency->setValue((int)obs_data_get_int(settings, "transport_latency"));
+	connect(latency, &QSpinBox::valueChanged,
+		[latency, settings] { obs_data_set_int(settings, "transport_latency", latency->value()); });
+	transportPageLayout->addRow(QString::fromUtf8(obs_module_text("TransportLatency")), latency);
+
+	auto passphrase = new QLineEdit;
+	passphrase->setEchoMode(QLineEdit::Password);
+	passphrase->setText(QString::fromUtf8(obs_data_get_string(settings, "transport_passphrase")));
+	connect(passphrase, &QLineEdit::textChanged, [passphrase, settings] {
+		obs_data_set_string(settings, "transport_passphrase", passphrase->text().toUtf8().constData());
+	});
+	transportPageLayout->addRow(QString::fromUtf8(obs_module_text("TransportPassphrase")), passphrase);
+
+	auto keyLength = new QComboBox;
+	keyLength->addItem(QString::fromUtf8(obs_module_text("Auto")), 0);
+	keyLength->addItem(QString::fromUtf8("AES-128"), 16);
+	if (protocol == TRANSPORT_SRT)
+		keyLength->addItem(QString::fromUtf8("AES-192"), 24);
+	keyLength->addItem(QString::fromUtf8("AES-256"), 32);
+	auto key_length_index = keyLength->findData((int)obs_data_get_int(settings, "transport_pbkeylen"));
+	keyLength->setCurrentIndex(key_length_index >= 0 ? key_length_index : 0);
+	connect(keyLength, &QComboBox::currentIndexChanged,
+		[keyLength, settings] { obs_data_set_int(settings, "transport_pbkeylen", keyLength->currentData().toInt()); });
+	transportPageLayout->addRow(QString::fromUtf8(obs_module_text("TransportKeyLength")), keyLength);
+
+	if (protocol != TRANSPORT_SRT)
+		return transportPage;
+
+	auto bufferSize = new QSpinBox;
+	bufferSize->setRange(0, 64 * 1024 * 1024);
+	bufferSize->setSingleStep(1024 * 1024);
+	bufferSize->setSuffix(QString::fromUtf8(" B"));
+	bufferSize->setSpecialValueText(QString::fromUtf8(obs_module_text("Auto")));
+	bufferSize->setValue((int)obs_data_get_int(settings, "transport_buffer_size"));
+	connect(bufferSize, &QSpinBox::valueChanged,
+		[bufferSize, settings] { obs_data_set_int(settings, "transport_buffer_size", bufferSize->value()); });
+	transportPageLayout->addRow(QString::fromUtf8(obs_module_text("TransportBufferSize")), bufferSize);
+
+	// SRT payloads carry whole 188 byte MPEG-TS packets, 1316 is the default and 1456 the maximum
+	auto packetSize = new QSpinBox;
+	packetSize->setRange(0, 1456);
+	packetSize->setSingleStep(188);
+	packetSize->setSuffix(QString::fromUtf8(" B"));
+	packetSize->setSpecialValueText(QString::fromUtf8(obs_module_text("Auto")));
+	packetSize->setValue((int)obs_data_get_int(settings, "transport_packet_size"));
+	connect(packetSize, &QSpinBox::valueChanged,
+		[packetSize, settings] { obs_data_set_int(settings, "transport_packet_size", packetSize->value()); });
+	transportPageLayout->addRow(QString::fromUtf8(obs_module_text("TransportPacketSize")), packetSize);
+
+	return transportPage;
+}
+
+// The dock keeps the vertical settings it got from the vertical plugin, the dialog edits a copy so cancel leaves them alone
+void OBSBasicSettings::SetVerticalOutputs(obs_data_array_t *outputs)
+{
+	if (vertical_outputs)
+		obs_data_array_release(vertical_outputs);
+	vertical_outputs = nullptr;
+	vertical_outputs_json.clear();
+	// Disable button if we don't have vertical
+	verticalAddButton->setEnabled(outputs != nullptr);
+	if (!outputs)
+		return;
+	vertical_outputs = obs_data_array_create();
+	for (size_t i = 0; i < obs_data_array_count(outputs); i++) {
+		auto item = obs_data_array_item(outputs, i);
+		auto copy = obs_data_create();
+		obs_data_apply(copy, item);
+		obs_data_array_push_back(vertical_outputs, copy);
+		obs_data_release(copy);
+		obs_data_release(item);
+	}
+	vertical_outputs_json = settings_array_json(vertical_outputs);
+}
+
+bool OBSBasicSettings::VerticalOutputsChanged() const
 {
+	return vertical_outputs && settings_array_json(vertical_outputs) != vertical_outputs_json;
+}
+
+void OBSBasicSettings::LoadVerticalSettings()
+{
+	TRACE_SCOPE("OBSBasicSettings::LoadVerticalSettings");
 	while (verticalOutputsLayout->rowCount() > 1) {
 		auto i = verticalOutputsLayout->takeRow(1).fieldItem;
 		RemoveLayoutItem(i);
 		verticalOutputsLayout->removeRow(1);
 	}
-	if (load) {
-		auto ph = obs_get_proc_handler();
-		struct calldata cd;
-		calldata_init(&cd);
-		if (!proc_handler_call(ph, "aitum_vertical_get_stream_settings", &cd)) {
-			// Disable button if we don't have vertical
-			verticalAddButton->setEnabled(false);
-			calldata_free(&cd);
-			return;
-		}
-		if (vertical_outputs)
-			obs_data_array_release(vertical_outputs);
-		vertical_outputs = (obs_data_array_t *)calldata_ptr(&cd, "outputs");
-		calldata_free(&cd);
-	}
 	obs_data_array_enum(
 		vertical_outputs,
 		[](obs_data_t *data2, void *param) {
@@ -1021,10 +1562,12 @@ void OBSBasicSettings::LoadVerticalSettings(bool load)
 			d->AddServer(d->verticalOutputsLayout, data2, d->vertical_outputs);
 		},
 		this);
+	UpdateCapacity();
 }
 
 void OBSBasicSettings::SaveVerticalSettings()
 {
+	TRACE_SCOPE("OBSBasicSettings::SaveVerticalSettings");
 	if (!vertical_outputs)
 		return;
 	auto ph = obs_get_proc_handler();
@@ -1037,12 +1580,19 @@ void OBSBasicSettings::SaveVerticalSettings()
 
 void OBSBasicSettings::LoadSettings(obs_data_t *settings)
 {
+	TRACE_SCOPE("OBSBasicSettings::LoadSettings");
 	while (mainOutputsLayout->rowCount() > 2) {
 		auto i = mainOutputsLayout->takeRow(2).fieldItem;
 		RemoveLayoutItem(i);
 		mainOutputsLayout->removeRow(2);
 	}
 	main_settings = settings;
+	preflightProbeCheckbox->setChecked(obs_data_get_bool(settings, "preflight_probe"));
+	resumeLiveOutputsCheckbox->setChecked(obs_data_get_bool(settings, "resume_live_outputs"));
+	uploadBudget->setValue((int)obs_data_get_int(settings, "upload_budget"));
+	scheduleLead->setValue(obs_data_has_user_value(settings, "schedule_lead") ? (int)obs_data_get_int(settings, "schedule_lead")
+										  : SCHEDULE_DEFAULT_LEAD);
+	uploadBudgetMode->setCurrentIndex(uploadBudgetMode->findData((int)obs_data_get_int(settings, "upload_budget_mode")));
 	auto outputs = obs_data_get_array(settings, "outputs");
 	obs_data_array_enum(
 		outputs,
@@ -1054,6 +1604,69 @@ void OBSBasicSettings::LoadSettings(obs_data_t *settings)
 		},
 		this);
 	obs_data_array_release(outputs);
+	UpdateCapacity();
+}
+
+static void capacity_add_workloads(obs_data_array_t *outputs, bool vertical, std::vector<encoder_workload> &workloads)
+{
+	size_t count = obs_data_array_count(outputs);
+	for (size_t i = 0; i < count; i++) {
+		auto settings = obs_data_array_item(outputs, i);
+		encoder_workload workload;
+		if (capacity_workload_from_settings(settings, vertical, workload))
+			workloads.push_back(workload);
+		obs_data_release(settings);
+	}
+}
+
+std::vector<encoder_workload> OBSBasicSettings::CapacityWorkloads()
+{
+	std::vector<encoder_workload> workloads;
+	auto outputs = main_settings ? obs_data_get_array(main_settings, "outputs") : nullptr;
+	capacity_add_workloads(outputs, false, workloads);
+	obs_data_array_release(outputs);
+	capacity_add_workloads(vertical_outputs, true, workloads);
+	return workloads;
+}
+
+void OBSBasicSettings::UpdateCapacity()
+{
+	auto workloads = CapacityWorkloads();
+	if (workloads.empty()) {
+		capacityLabel->setText(QString::fromUtf8(obs_module_text("EncoderCapacityNone")));
+		capacityLabel->setStyleSheet(QString::fromUtf8(""));
+		return;
+	}
+	double cpu = 0.0;
+	int unknown = 0;
+	bool lagging = false;
+	QStringList lines;
+	for (auto &workload : workloads) {
+		auto estimate = capacity_estimate_workload(encoder_costs, workload);
+		if (!estimate.known) {
+			unknown++;
+			continue;
+		}
+		cpu += estimate.cpu;
+		if (estimate.lagging) {
+			lagging = true;
+			lines.append(QString::fromUtf8(obs_module_text("EncoderCapacityLagging"))
+					     .arg(QString::fromUtf8(workload.name.c_str())));
+		}
+	}
+	const bool overloaded = cpu > CAPACITY_CPU_LIMIT;
+	lines.prepend(QString::fromUtf8(obs_module_text("EncoderCapacityPrediction")).arg(qRound(cpu)));
+	if (overloaded)
+		lines.append(QString::fromUtf8(obs_module_text("EncoderCapacityOverloaded")).arg(CAPACITY_CPU_LIMIT));
+	if (unknown)
+		lines.append(QString::fromUtf8(obs_module_text("EncoderCapacityUnknown")).arg(unknown));
+	capacityLabel->setText(lines.join(QString::fromUtf8("\n")));
+	const char *color = "rgb(0,210,153)";
+	if (overloaded || lagging)
+		color = "rgb(210,60,60)";
+	else if (unknown)
+		color = "rgb(192,128,0)";
+	capacityLabel->setStyleSheet(QString::fromUtf8("color: %1;").arg(QString::fromUtf8(color)));
 }
 
 void OBSBasicSettings::AddProperty(obs_properties_t *properties, obs_property_t *property, obs_data_t *settings,
@@ -1326,172 +1939,17 @@ void OBSBasicSettings::RefreshProperties(obs_properties_t *properties, QFormLayo
 		obs_property_next(&property);
 	}
 }
-static bool obs_encoder_parent_video_loaded = false;
-static video_t *(*obs_encoder_parent_video_wrapper)(const obs_encoder_t *encoder) = nullptr;
-
 void OBSBasicSettings::LoadOutputStats(std::vector<video_t *> *oldVideos)
 {
-	if (!obs_encoder_parent_video_loaded) {
-#ifdef _WIN32
-		void *dl = os_dlopen("obs");
-#else
-		void *dl = dlopen(nullptr, RTLD_LAZY);
-#endif
-		if (dl) {
-			auto sym = os_dlsym(dl, "obs_encoder_parent_video");
-			if (sym)
-				obs_encoder_parent_video_wrapper = (video_t * (*)(const obs_encoder_t *encoder)) sym;
-			os_dlclose(dl);
-		}
-		obs_encoder_parent_video_loaded = true;
-	}
-	std::vector<std::tuple<video_t *, obs_encoder_t *, obs_output_t *>> refs;
-	obs_enum_outputs(
-		[](void *param, obs_output_t *output) {
-			auto refs2 = (std::vector<std::tuple<video_t *, obs_encoder_t *, obs_output_t *>> *)param;
-			auto ec = 0;
-			for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
-				auto venc = obs_output_get_video_encoder2(output, i);
-				if (!venc)
-					continue;
-				ec++;
-				video_t *video = obs_encoder_parent_video_wrapper ? obs_encoder_parent_video_wrapper(venc)
-										  : obs_encoder_video(venc);
-				if (!video)
-					video = obs_output_video(output);
-				refs2->push_back(std::tuple<video_t *, obs_encoder_t *, obs_output_t *>(video, venc, output));
-			}
-			if (!ec) {
-				refs2->push_back(std::tuple<video_t *, obs_encoder_t *, obs_output_t *>(obs_output_video(output),
-													nullptr, output));
-			}
-			return true;
-		},
-		&refs);
-	std::sort(refs.begin(), refs.end(),
-		  [](std::tuple<video_t *, obs_encoder_t *, obs_output_t *> const &a,
-		     std::tuple<video_t *, obs_encoder_t *, obs_output_t *> const &b) {
-			  video_t *va;
-			  video_t *vb;
-			  obs_encoder_t *ea;
-			  obs_encoder_t *eb;
-			  obs_output_t *oa;
-			  obs_output_t *ob;
-			  std::tie(va, ea, oa) = a;
-			  std::tie(vb, eb, ob) = b;
-			  if (va == vb) {
-				  if (ea == eb) {
-					  return oa < ob;
-				  }
-				  return va < vb;
-			  }
-			  return va < vb;
-		  });
-	std::string stats;
-	video_t *last_video = nullptr;
-	auto video_count = 0;
-	video_t *vertical_video = nullptr;
-	auto ph = obs_get_proc_handler();
-	struct calldata cd;
-	calldata_init(&cd);
-	if (proc_handler_call(ph, "aitum_vertical_get_video", &cd))
-		vertical_video = (video_t *)calldata_ptr(&cd, "video");
-	calldata_free(&cd);
-	for (auto it = refs.begin(); it != refs.end(); it++) {
-		video_t *video;
-		obs_encoder_t *encoder;
-		obs_output_t *output;
-		std::tie(video, encoder, output) = *it;
-
-		if (!video) {
-			stats += "No Canvas ";
-		} else if (vertical_video && vertical_video == video) {
-			stats += "Vertical Canvas ";
-		} else if (video == obs_get_video()) {
-			stats += "Main Canvas ";
-		} else if (std::find(oldVideos->begin(), oldVideos->end(), video) != oldVideos->end()) {
-			stats += "Old Main Canvas ";
-		} else {
-			if (last_video != video) {
-				video_count++;
-				last_video = video;
-			}
-			stats += "Custom Canvas ";
-			stats += std::to_string(video_count);
-			stats += " ";
-		}
-		if (video && std::find(oldVideos->begin(), oldVideos->end(), video) != oldVideos->end()) {
-			stats += obs_output_active(output) ? "Active " : "Inactive ";
-		} else if (encoder) {
-			stats += "(";
-			stats += std::to_string(obs_encoder_get_width(encoder));
-			stats += "x";
-			stats += std::to_string(obs_encoder_get_height(encoder));
-			stats += ") ";
-			stats += obs_encoder_get_name(encoder);
-			stats += "(";
-			stats += obs_encoder_get_id(encoder);
-			stats += ") ";
-			stats += to_string_with_precision(
-				video_output_get_frame_rate(video) / obs_encoder_get_frame_rate_divisor(encoder), 2);
-			stats += "fps ";
-			stats += obs_encoder_active(encoder) ? "Active " : "Inactive ";
-			if (video) {
-				stats += "skipped frames ";
-				stats += std::to_string(video_output_get_skipped_frames(video));
-				stats += "/";
-				stats += std::to_string(video_output_get_total_frames(video));
-				stats += " ";
-			}
-		} else if (video) {
-			stats += "(";
-			stats += std::to_string(video_output_get_width(video));
-			stats += "x";
-			stats += std::to_string(video_output_get_height(video));
-			stats += ") ";
-			stats += to_string_with_precision(video_output_get_frame_rate(video), 2);
-			stats += "fps ";
-			stats += video_output_active(video) ? "Active " : "Inactive ";
-			stats += "skipped frames ";
-			stats += std::to_string(video_output_get_skipped_frames(video));
-			stats += "/";
-			stats += std::to_string(video_output_get_total_frames(video));
-			stats += " ";
-		} else {
-			stats += "(";
-			stats += std::to_string(obs_output_get_width(output));
-			stats += "x";
-			stats += std::to_string(obs_output_get_height(output));
-			stats += ") ";
-			stats += obs_output_active(output) ? "Active " : "Inactive ";
-		}
-		stats += obs_output_get_name(output);
-		stats += "(";
-		stats += obs_output_get_id(output);
-		stats += ") ";
-		stats += std::to_string(obs_output_get_connect_time_ms(output));
-		stats += "ms ";
-		//obs_output_get_total_bytes(output);
-		stats += "dropped frames ";
-		stats += std::to_string(obs_output_get_frames_dropped(output));
-		stats += "/";
-		stats += std::to_string(obs_output_get_total_frames(output));
-		obs_service_t *service = obs_output_get_service(output);
-		if (service) {
-			stats += " ";
-			stats += obs_service_get_name(service);
-			stats += "(";
-			stats += obs_service_get_id(service);
-			stats += ")";
-			auto url = obs_service_get_connect_info(service, OBS_SERVICE_CONNECT_INFO_SERVER_URL);
-			if (url) {
-				stats += " ";
-				stats += url;
-			}
-		}
-		stats += "\n";
-	}
-	troubleshooterText->setText(QString::fromUtf8(stats));
+	TRACE_SCOPE("OBSBasicSettings::LoadOutputStats");
+	troubleshooterText->clear();
+	topologyModel->SetOldVideos(*oldVideos);
+	topologyModel->Refresh();
+}
+
+void OBSBasicSettings::AppendTroubleshooterText(const QString &text)
+{
+	troubleshooterText->append(text);
 }
 
 void OBSBasicSettings::SetNewerVersion(QString newer_version_available)
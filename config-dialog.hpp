@@ -15,6 +15,11 @@
 #include <QIcon>
 #include <QString>
 #include <QToolButton>
+#include "capacity-planner.hpp"
+#include "transport.hpp"
+
+class LoopbackTest;
+class TopologyModel;
 
 class OBSBasicSettings : public QDialog {
 	Q_OBJECT
@@ -27,6 +32,8 @@ class OBSBasicSettings : public QDialog {
 	Q_PROPERTY(QIcon hotkeysIcon READ GetHotkeysIcon WRITE SetHotkeysIcon DESIGNABLE true)
 	Q_PROPERTY(QIcon accessibilityIcon READ GetAccessibilityIcon WRITE SetAccessibilityIcon DESIGNABLE true)
 	Q_PROPERTY(QIcon advancedIcon READ GetAdvancedIcon WRITE SetAdvancedIcon DESIGNABLE true)
+	friend class UiBenchmark;
+
 private:
 	QListWidget *listWidget;
 
@@ -43,9 +50,15 @@ private:
 	void AddServer(QFormLayout *outputsLayout, obs_data_t *settings, obs_data_array_t *outputs);
 	void AddProperty(obs_properties_t *properties, obs_property_t *property, obs_data_t *settings, QFormLayout *layout);
 	void RefreshProperties(obs_properties_t *properties, QFormLayout *layout);
+	QWidget *StreamPage(obs_data_t *settings);
+	QWidget *RecordPage(obs_data_t *settings);
+	QWidget *TransportPage(obs_data_t *settings, transport_protocol protocol);
+	std::vector<encoder_workload> CapacityWorkloads();
+	void UpdateCapacity();
 
 	obs_data_t *main_settings = nullptr;
 	obs_data_array_t *vertical_outputs = nullptr;
+	std::string vertical_outputs_json;
 
 	std::map<obs_property_t *, QWidget *> encoder_property_widgets;
 	std::map<QWidget *, obs_properties_t *> video_encoder_properties;
@@ -56,6 +69,18 @@ private:
 	QLabel *newVersion;
 
 	QTextEdit *troubleshooterText;
+	TopologyModel *topologyModel;
+	QPushButton *loopbackButton;
+	QCheckBox *preflightProbeCheckbox;
+	QCheckBox *resumeLiveOutputsCheckbox;
+	QSpinBox *uploadBudget;
+	QSpinBox *scheduleLead;
+	QComboBox *uploadBudgetMode;
+	LoopbackTest *loopbackTest = nullptr;
+	QLabel *capacityLabel;
+	QPushButton *capacityButton;
+	CapacityBenchmark *capacityBenchmark = nullptr;
+	obs_data_t *encoder_costs = nullptr;
 
 	QPushButton *verticalAddButton;
 	QToolButton *generalMainButton;
@@ -79,10 +104,13 @@ public:
 	~OBSBasicSettings();
 
 	void LoadSettings(obs_data_t *settings);
-	void LoadVerticalSettings(bool load);
+	void SetVerticalOutputs(obs_data_array_t *outputs);
+	void LoadVerticalSettings();
 	void SaveVerticalSettings();
+	bool VerticalOutputsChanged() const;
 	void LoadOutputStats(std::vector<video_t *> *oldVideos);
 	void SetNewerVersion(QString newer_version_available);
+	void AppendTroubleshooterText(const QString &text);
 
 public slots:
 };
@@ -75,28 +75,33 @@ void ConfigUtils::updateButtonStyles(QPushButton *defaultButton, QPushButton *cu
 	customButton->setProperty("unselected", activeIndex != 1 ? true : false);
 }
 
-// Platform icons deciphered from endpoints
-QIcon ConfigUtils::getPlatformIconFromEndpoint(QString endpoint)
+// Platforms deciphered from endpoints
+QString ConfigUtils::getPlatformFromEndpoint(QString endpoint)
 {
 
 	if (endpoint.contains(QString::fromUtf8("ingest.global-contribute.live-video.net")) ||
 	    endpoint.contains(QString::fromUtf8(".contribute.live-video.net")) ||
 	    endpoint.contains(QString::fromUtf8(".twitch.tv"))) { // twitch
-		return QIcon(":/aitum/media/twitch.png");
+		return QString::fromUtf8("twitch");
 	} else if (endpoint.contains(QString::fromUtf8(".youtube.com"))) { // youtube
-		return QIcon(":/aitum/media/youtube.png");
+		return QString::fromUtf8("youtube");
 	} else if (endpoint.contains(QString::fromUtf8("fa723fc1b171.global-contribute.live-video.net"))) { // kick
-		return QIcon(":/aitum/media/kick.png");
+		return QString::fromUtf8("kick");
 	} else if (endpoint.contains(QString::fromUtf8(".tiktokcdn"))) { // tiktok
-		return QIcon(":/aitum/media/tiktok.png");
+		return QString::fromUtf8("tiktok");
 	} else if (endpoint.contains(QString::fromUtf8(".pscp.tv"))) { // twitter
-		return QIcon(":/aitum/media/twitter.png");
+		return QString::fromUtf8("twitter");
 	} else if (endpoint.contains(QString::fromUtf8("livepush.trovo.live"))) { // trovo
-		return QIcon(":/aitum/media/trovo.png");
+		return QString::fromUtf8("trovo");
 	} else if (endpoint.contains(QString::fromUtf8(".facebook.com")) ||
 		   endpoint.contains(QString::fromUtf8(".fbcdn.net"))) { // facebook
-		return QIcon(":/aitum/media/facebook.png");
+		return QString::fromUtf8("facebook");
 	} else { // unknown
-		return QIcon(":/aitum/media/unknown.png");
+		return QString::fromUtf8("unknown");
 	}
 }
+
+QIcon ConfigUtils::getPlatformIconFromEndpoint(QString endpoint)
+{
+	return QIcon(QString::fromUtf8(":/aitum/media/%1.png").arg(getPlatformFromEndpoint(endpoint)));
+}
@@ -22,5 +22,7 @@ public:
 
 	static void updateButtonStyles(QPushButton *defaultButton, QPushButton *customButton, int activeIndex);
 
+	// Platform name the icons in the resources are named after, "unknown" when not recognized
+	static QString getPlatformFromEndpoint(QString endpoint);
 	static QIcon getPlatformIconFromEndpoint(QString endpoint);
 };
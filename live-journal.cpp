@@ -0,0 +1,107 @@
+#include "live-journal.hpp"
+#include <obs-module.h>
+#include <util/platform.h>
+#include <algorithm>
+#include <cstring>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#define LIVE_JOURNAL_FILE "live-journal.log"
+
+static void sync_file(FILE *file)
+{
+	fflush(file);
+#ifdef _WIN32
+	_commit(_fileno(file));
+#else
+	fsync(fileno(file));
+#endif
+}
+
+LiveJournal::~LiveJournal()
+{
+	if (file)
+		fclose(file);
+}
+
+// One line per transition: "<1|0> <main|vertical> <name>"
+LiveJournal::destinations LiveJournal::Recover()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	destinations live;
+	char *path = obs_module_config_path(LIVE_JOURNAL_FILE);
+	if (!path)
+		return live;
+	char *data = os_quick_read_utf8_file(path);
+	if (data) {
+		char *line = data;
+		while (line && *line) {
+			char *next = strchr(line, '\n');
+			if (next)
+				*next++ = 0;
+			// A torn last line from the crash has no newline, it is ignored
+			if (next && (line[0] == '0' || line[0] == '1') && line[1] == ' ') {
+				const bool vertical = strncmp(line + 2, "vertical ", 9) == 0;
+				const bool main = strncmp(line + 2, "main ", 5) == 0;
+				if (main || vertical) {
+					std::pair<std::string, bool> destination(line + 2 + (vertical ? 9 : 5), vertical);
+					auto it = std::find(live.begin(), live.end(), destination);
+					if (line[0] == '1' && it == live.end())
+						live.push_back(destination);
+					else if (line[0] == '0' && it != live.end())
+						live.erase(it);
+				}
+			}
+			line = next;
+		}
+		bfree(data);
+	}
+	if (file)
+		fclose(file);
+	char *dir = obs_module_config_path("");
+	if (dir) {
+		os_mkdirs(dir);
+		bfree(dir);
+	}
+	file = os_fopen(path, "wb");
+	bfree(path);
+	if (!file)
+		blog(LOG_WARNING, "[Aitum Multistream] failed to open the live journal");
+	closed = false;
+	// Carried over until they are resumed or declined, another crash before that must not lose them
+	if (file && !live.empty()) {
+		for (auto &destination : live)
+			fprintf(file, "1 %s %s\n", destination.second ? "vertical" : "main", destination.first.c_str());
+		sync_file(file);
+	}
+	return live;
+}
+
+void LiveJournal::Record(const std::string &name, bool vertical, bool live)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!file || closed)
+		return;
+	std::string line = name;
+	std::replace(line.begin(), line.end(), '\n', ' ');
+	fprintf(file, "%c %s %s\n", live ? '1' : '0', vertical ? "vertical" : "main", line.c_str());
+	sync_file(file);
+}
+
+void LiveJournal::Close()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	closed = true;
+	if (!file)
+		return;
+	fclose(file);
+	file = nullptr;
+	char *path = obs_module_config_path(LIVE_JOURNAL_FILE);
+	if (path) {
+		os_unlink(path);
+		bfree(path);
+	}
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Append-only record of which destinations are live, synced to disk on every transition so it survives a crash.
+// A clean shutdown closes the journal, so whatever is left on the next start was live when OBS went down.
+class LiveJournal {
+public:
+	typedef std::vector<std::pair<std::string, bool>> destinations;
+
+	~LiveJournal();
+
+	// Destinations the previous session left live in the order they went live, then starts a new journal that still
+	// lists them as live until they are recorded otherwise
+	destinations Recover();
+	// Safe to call from output threads
+	void Record(const std::string &name, bool vertical, bool live);
+	// Clean shutdown, nothing to resume
+	void Close();
+
+private:
+	std::mutex mutex;
+	FILE *file = nullptr;
+	bool closed = false;
+};
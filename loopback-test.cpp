@@ -0,0 +1,648 @@
+#include "loopback-test.hpp"
+#include "stream-output.hpp"
+#include <util/platform.h>
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <map>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+#define close_socket closesocket
+#define poll WSAPoll
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int socket_t;
+#define INVALID_SOCKET -1
+#define close_socket close
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+#define RTMP_HANDSHAKE_SIZE 1536
+#define RTMP_DEFAULT_CHUNK_SIZE 128
+
+#define RTMP_MSG_SET_CHUNK_SIZE 1
+#define RTMP_MSG_COMMAND_AMF0 20
+
+LoopbackSink::LoopbackSink() : listenSocket((intptr_t)INVALID_SOCKET) {}
+
+LoopbackSink::~LoopbackSink()
+{
+	Stop();
+}
+
+bool LoopbackSink::Start()
+{
+#ifdef _WIN32
+	WSADATA wsad;
+	if (WSAStartup(MAKEWORD(2, 2), &wsad) != 0)
+		return false;
+#endif
+	socket_t s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	if (s == INVALID_SOCKET) {
+#ifdef _WIN32
+		WSACleanup();
+#endif
+		return false;
+	}
+
+	struct sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	socklen_t len = sizeof(addr);
+	if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(s, SOMAXCONN) != 0 ||
+	    getsockname(s, (struct sockaddr *)&addr, &len) != 0) {
+		close_socket(s);
+#ifdef _WIN32
+		WSACleanup();
+#endif
+		return false;
+	}
+	port = ntohs(addr.sin_port);
+	listenSocket = (intptr_t)s;
+	running = true;
+	thread = std::thread(&LoopbackSink::Run, this);
+	return true;
+}
+
+void LoopbackSink::Stop()
+{
+	running = false;
+	if (thread.joinable())
+		thread.join();
+	if ((socket_t)listenSocket != INVALID_SOCKET) {
+		close_socket((socket_t)listenSocket);
+		listenSocket = (intptr_t)INVALID_SOCKET;
+#ifdef _WIN32
+		WSACleanup();
+#endif
+	}
+}
+
+enum rtmp_state {
+	RTMP_STATE_C0C1,
+	RTMP_STATE_C2,
+	RTMP_STATE_COMMANDS,
+	RTMP_STATE_PUBLISHING,
+};
+
+struct rtmp_chunk_stream {
+	uint32_t length = 0;
+	uint8_t type = 0;
+	uint32_t stream_id = 0;
+	bool extended = false;
+	std::vector<uint8_t> payload;
+};
+
+// Just enough server side RTMP for the rtmp_output to publish: the plain handshake, connect, createStream and publish.
+// Everything after publish is media, it is only counted.
+struct rtmp_connection {
+	socket_t socket;
+	rtmp_state state = RTMP_STATE_C0C1;
+	uint32_t chunk_size = RTMP_DEFAULT_CHUNK_SIZE;
+	std::vector<uint8_t> in;
+	std::map<uint32_t, rtmp_chunk_stream> streams;
+};
+
+static uint32_t read_be(const uint8_t *data, size_t bytes)
+{
+	uint32_t value = 0;
+	for (size_t i = 0; i < bytes; i++)
+		value = (value << 8) | data[i];
+	return value;
+}
+
+static bool send_all(socket_t s, const uint8_t *data, size_t size)
+{
+	while (size) {
+		auto sent = send(s, (const char *)data, (int)size, MSG_NOSIGNAL);
+		if (sent <= 0)
+			return false;
+		data += sent;
+		size -= (size_t)sent;
+	}
+	return true;
+}
+
+static void amf_string(std::vector<uint8_t> &b, const char *value, bool marker = true)
+{
+	size_t len = strlen(value);
+	if (marker)
+		b.push_back(0x02);
+	b.push_back((uint8_t)(len >> 8));
+	b.push_back((uint8_t)len);
+	b.insert(b.end(), value, value + len);
+}
+
+static void amf_number(std::vector<uint8_t> &b, double value)
+{
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	b.push_back(0x00);
+	for (int i = 7; i >= 0; i--)
+		b.push_back((uint8_t)(bits >> (i * 8)));
+}
+
+static void amf_null(std::vector<uint8_t> &b)
+{
+	b.push_back(0x05);
+}
+
+static void amf_status(std::vector<uint8_t> &b, const char *code, const char *description)
+{
+	b.push_back(0x03);
+	amf_string(b, "level", false);
+	amf_string(b, "status");
+	amf_string(b, "code", false);
+	amf_string(b, code);
+	amf_string(b, "description", false);
+	amf_string(b, description);
+	b.push_back(0x00);
+	b.push_back(0x00);
+	b.push_back(0x09);
+}
+
+// Sends a command as type 0 chunk on chunk stream 3, split at the default chunk size
+static bool rtmp_send_command(socket_t s, uint32_t stream_id, const std::vector<uint8_t> &payload)
+{
+	std::vector<uint8_t> b = {0x03, 0, 0, 0};
+	b.push_back((uint8_t)(payload.size() >> 16));
+	b.push_back((uint8_t)(payload.size() >> 8));
+	b.push_back((uint8_t)payload.size());
+	b.push_back(RTMP_MSG_COMMAND_AMF0);
+	for (int i = 0; i < 4; i++)
+		b.push_back((uint8_t)(stream_id >> (i * 8)));
+	for (size_t i = 0; i < payload.size(); i += RTMP_DEFAULT_CHUNK_SIZE) {
+		if (i)
+			b.push_back(0xC3);
+		size_t chunk = std::min(payload.size() - i, (size_t)RTMP_DEFAULT_CHUNK_SIZE);
+		b.insert(b.end(), payload.begin() + (ptrdiff_t)i, payload.begin() + (ptrdiff_t)(i + chunk));
+	}
+	return send_all(s, b.data(), b.size());
+}
+
+static bool rtmp_handle_command(rtmp_connection &c, const rtmp_chunk_stream &cs)
+{
+	auto &p = cs.payload;
+	if (p.size() < 3 || p[0] != 0x02)
+		return true;
+	size_t len = read_be(p.data() + 1, 2);
+	if (p.size() < 3 + len + 9 || p[3 + len] != 0x00)
+		return true;
+	std::string command((const char *)p.data() + 3, len);
+	uint64_t bits = 0;
+	for (size_t i = 0; i < 8; i++)
+		bits = (bits << 8) | p[4 + len + i];
+	double transaction;
+	memcpy(&transaction, &bits, sizeof(transaction));
+
+	std::vector<uint8_t> reply;
+	if (command == "connect") {
+		amf_string(reply, "_result");
+		amf_number(reply, transaction);
+		amf_null(reply);
+		amf_status(reply, "NetConnection.Connect.Success", "Connection succeeded.");
+		return rtmp_send_command(c.socket, 0, reply);
+	}
+	if (command == "createStream") {
+		amf_string(reply, "_result");
+		amf_number(reply, transaction);
+		amf_null(reply);
+		amf_number(reply, 1.0);
+		return rtmp_send_command(c.socket, 0, reply);
+	}
+	if (command == "publish") {
+		amf_string(reply, "onStatus");
+		amf_number(reply, 0.0);
+		amf_null(reply);
+		amf_status(reply, "NetStream.Publish.Start", "Publishing.");
+		c.state = RTMP_STATE_PUBLISHING;
+		return rtmp_send_command(c.socket, cs.stream_id, reply);
+	}
+	return true;
+}
+
+// Consumes what arrived so far, false when the connection has to be closed
+static bool rtmp_process(rtmp_connection &c, std::atomic<size_t> &publishCount)
+{
+	static const size_t header_sizes[] = {11, 7, 3, 0};
+	if (c.state == RTMP_STATE_C0C1) {
+		if (c.in.size() < 1 + RTMP_HANDSHAKE_SIZE)
+			return true;
+		// S0, S1 with zero time and zero version, S2 echoes C1
+		std::vector<uint8_t> reply(1 + RTMP_HANDSHAKE_SIZE, 0);
+		reply[0] = 0x03;
+		reply.insert(reply.end(), c.in.begin() + 1, c.in.begin() + 1 + RTMP_HANDSHAKE_SIZE);
+		c.in.erase(c.in.begin(), c.in.begin() + 1 + RTMP_HANDSHAKE_SIZE);
+		c.state = RTMP_STATE_C2;
+		if (!send_all(c.socket, reply.data(), reply.size()))
+			return false;
+	}
+	if (c.state == RTMP_STATE_C2) {
+		if (c.in.size() < RTMP_HANDSHAKE_SIZE)
+			return true;
+		c.in.erase(c.in.begin(), c.in.begin() + RTMP_HANDSHAKE_SIZE);
+		c.state = RTMP_STATE_COMMANDS;
+	}
+	size_t pos = 0;
+	while (c.state == RTMP_STATE_COMMANDS && pos < c.in.size()) {
+		const uint8_t *d = c.in.data() + pos;
+		size_t available = c.in.size() - pos;
+		uint8_t fmt = d[0] >> 6;
+		uint32_t csid = d[0] & 0x3f;
+		size_t header = 1;
+		if (csid < 2) {
+			header += csid + 1;
+			if (available < header)
+				break;
+			csid = 64 + d[1] + (csid == 1 ? d[2] * 256u : 0u);
+		}
+		if (available < header + header_sizes[fmt])
+			break;
+		auto &cs = c.streams[csid];
+		const uint8_t *h = d + header;
+		bool extended = fmt < 3 ? read_be(h, 3) == 0xffffff : cs.extended;
+		uint32_t length = fmt < 2 ? read_be(h + 3, 3) : cs.length;
+		size_t size = header + header_sizes[fmt] + (extended ? 4 : 0);
+		size_t chunk = std::min((size_t)length - cs.payload.size(), (size_t)c.chunk_size);
+		if (available < size + chunk)
+			break;
+		cs.extended = extended;
+		if (fmt < 2) {
+			cs.length = length;
+			cs.type = h[6];
+		}
+		if (fmt == 0)
+			cs.stream_id = (uint32_t)h[7] | (uint32_t)h[8] << 8 | (uint32_t)h[9] << 16 | (uint32_t)h[10] << 24;
+		cs.payload.insert(cs.payload.end(), d + size, d + size + chunk);
+		pos += size + chunk;
+		if (cs.payload.size() < cs.length)
+			continue;
+		if (cs.type == RTMP_MSG_SET_CHUNK_SIZE && cs.payload.size() >= 4) {
+			c.chunk_size = read_be(cs.payload.data(), 4) & 0x7fffffff;
+			if (!c.chunk_size)
+				return false;
+		} else if (cs.type == RTMP_MSG_COMMAND_AMF0) {
+			if (!rtmp_handle_command(c, cs))
+				return false;
+			if (c.state == RTMP_STATE_PUBLISHING)
+				publishCount++;
+		}
+		cs.payload.clear();
+	}
+	if (c.state == RTMP_STATE_PUBLISHING)
+		c.in.clear();
+	else
+		c.in.erase(c.in.begin(), c.in.begin() + (ptrdiff_t)pos);
+	return true;
+}
+
+void LoopbackSink::Run()
+{
+	os_set_thread_name("aitum-multistream-loopback-sink");
+	std::vector<struct pollfd> fds;
+	std::vector<rtmp_connection> connections;
+	struct pollfd listen_fd = {};
+	listen_fd.fd = (socket_t)listenSocket;
+	listen_fd.events = POLLIN;
+	fds.push_back(listen_fd);
+	char buffer[65536];
+
+	while (running) {
+		if (poll(fds.data(), (unsigned long)fds.size(), 100) <= 0)
+			continue;
+		for (size_t i = fds.size(); i > 1; i--) {
+			auto &fd = fds[i - 1];
+			if (!fd.revents)
+				continue;
+			auto &c = connections[i - 2];
+			auto received = recv(fd.fd, buffer, (int)sizeof(buffer), 0);
+			if (received > 0) {
+				receivedBytes += (uint64_t)received;
+				if (c.state == RTMP_STATE_PUBLISHING)
+					continue;
+				c.in.insert(c.in.end(), buffer, buffer + received);
+				if (rtmp_process(c, publishCount))
+					continue;
+			}
+			close_socket(fd.fd);
+			fds.erase(fds.begin() + (ptrdiff_t)(i - 1));
+			connections.erase(connections.begin() + (ptrdiff_t)(i - 2));
+		}
+		if (fds[0].revents & POLLIN) {
+			socket_t client = accept((socket_t)listenSocket, nullptr, nullptr);
+			if (client != INVALID_SOCKET) {
+				struct pollfd client_fd = {};
+				client_fd.fd = client;
+				client_fd.events = POLLIN;
+				fds.push_back(client_fd);
+				rtmp_connection c;
+				c.socket = client;
+				connections.push_back(std::move(c));
+				connectionCount++;
+			}
+		}
+	}
+	for (size_t i = 1; i < fds.size(); i++)
+		close_socket(fds[i].fd);
+}
+
+struct loopback_output {
+	std::string name;
+	obs_output_t *output = nullptr;
+	uint64_t start_time = 0;
+	std::atomic<uint64_t> connect_time = 0;
+};
+
+static void loopback_output_start(void *data, calldata_t *calldata)
+{
+	UNUSED_PARAMETER(calldata);
+	auto lo = (loopback_output *)data;
+	lo->connect_time = os_gettime_ns();
+}
+
+LoopbackTest::LoopbackTest(video_t *video_, audio_t *audio_, int maxOutputs_, int durationSeconds_, std::string resultsPath_,
+			   std::string recordDir_, progress_cb progress_, std::function<void()> finished_)
+	: video(video_),
+	  audio(audio_),
+	  maxOutputs(maxOutputs_),
+	  durationSeconds(durationSeconds_),
+	  resultsPath(resultsPath_),
+	  recordDir(recordDir_),
+	  progress(progress_),
+	  finished(finished_)
+{
+	thread = std::thread(&LoopbackTest::Run, this);
+}
+
+LoopbackTest::~LoopbackTest()
+{
+	Abort();
+	if (thread.joinable())
+		thread.join();
+}
+
+void LoopbackTest::Abort()
+{
+	aborted = true;
+}
+
+bool LoopbackTest::Wait(uint64_t ms)
+{
+	for (uint64_t waited = 0; waited < ms && !aborted; waited += 50)
+		os_sleep_ms(50);
+	return !aborted;
+}
+
+void LoopbackTest::Run()
+{
+	os_set_thread_name("aitum-multistream-loopback-test");
+	LoopbackSink sink;
+	obs_encoder_t *venc = nullptr;
+	obs_encoder_t *aenc = nullptr;
+	obs_data_t *results = obs_data_create();
+	obs_data_array_t *runs = obs_data_array_create();
+
+	if (!sink.Start()) {
+		progress("Loopback test: failed to start local sink");
+		failures++;
+	} else {
+		progress("Loopback test: RTMP sink listening on 127.0.0.1:" + std::to_string(sink.GetPort()));
+		auto s = obs_data_create();
+		obs_data_set_string(s, "rate_control", "CBR");
+		obs_data_set_int(s, "bitrate", 2500);
+		obs_data_set_string(s, "preset", "veryfast");
+		venc = obs_video_encoder_create("obs_x264", "aitum_multi_loopback_video", s, nullptr);
+		obs_data_release(s);
+		s = obs_data_create();
+		obs_data_set_int(s, "bitrate", 160);
+		aenc = obs_audio_encoder_create("ffmpeg_aac", "aitum_multi_loopback_audio", s, 0, nullptr);
+		obs_data_release(s);
+		if (!venc || !aenc) {
+			progress("Loopback test: failed to create test encoders");
+			failures++;
+		} else {
+			obs_encoder_set_video(venc, video);
+			obs_encoder_set_audio(aenc, audio);
+			for (int count = 1; !aborted; count *= 2) {
+				if (count > maxOutputs)
+					count = maxOutputs;
+				if (!RunRound(sink, venc, aenc, count, runs) || count == maxOutputs)
+					break;
+			}
+			if (!recordDir.empty() && !aborted)
+				RunRecording(sink, venc, aenc, results);
+		}
+	}
+	obs_encoder_release(venc);
+	obs_encoder_release(aenc);
+	sink.Stop();
+
+	obs_data_set_int(results, "timestamp", (long long)time(nullptr));
+	obs_data_set_int(results, "duration", durationSeconds);
+	obs_data_set_int(results, "failures", failures);
+	obs_data_set_array(results, "runs", runs);
+	obs_data_array_release(runs);
+	if (!resultsPath.empty() && obs_data_save_json_safe(results, resultsPath.c_str(), "tmp", "bak"))
+		progress("Loopback test: results saved to " + resultsPath);
+	obs_data_release(results);
+	if (aborted)
+		progress("Loopback test: aborted");
+	running = false;
+	finished();
+}
+
+bool LoopbackTest::RunRound(LoopbackSink &sink, obs_encoder_t *venc, obs_encoder_t *aenc, int count, obs_data_array_t *runs)
+{
+	progress("Loopback test: starting " + std::to_string(count) + " output(s)");
+	std::string server = "rtmp://127.0.0.1:" + std::to_string(sink.GetPort()) + "/live";
+	uint64_t sinkBytes = sink.GetReceivedBytes();
+	size_t sinkPublished = sink.GetPublishCount();
+	std::vector<loopback_output *> los;
+	for (int i = 0; i < count; i++) {
+		auto lo = new loopback_output;
+		lo->name = "loopback-" + std::to_string(i + 1);
+		auto settings = obs_data_create();
+		obs_data_set_string(settings, "name", lo->name.c_str());
+		obs_data_set_string(settings, "stream_server", server.c_str());
+		obs_data_set_string(settings, "stream_key", lo->name.c_str());
+		// No profile, its delay and bind address would skew the measurement
+		lo->output = create_stream_output(settings, nullptr);
+		obs_data_release(settings);
+		if (!lo->output) {
+			progress("Loopback test: failed to create " + lo->name);
+			failures++;
+			delete lo;
+			continue;
+		}
+		obs_output_set_video_encoder(lo->output, venc);
+		obs_output_set_audio_encoder(lo->output, aenc, 0);
+		signal_handler_connect(obs_output_get_signal_handler(lo->output), "start", loopback_output_start, lo);
+		los.push_back(lo);
+	}
+	for (auto lo : los) {
+		lo->start_time = os_gettime_ns();
+		if (!obs_output_start(lo->output)) {
+			progress("Loopback test: failed to start " + lo->name);
+			failures++;
+		}
+	}
+
+	// Wait for every output to connect, at most 10 seconds
+	uint64_t waited = 0;
+	for (; waited < 10000 && !aborted; waited += 50) {
+		bool all = true;
+		for (auto lo : los)
+			all = all && lo->connect_time != 0;
+		if (all)
+			break;
+		os_sleep_ms(50);
+	}
+
+	std::vector<uint64_t> bytes;
+	std::vector<int> dropped;
+	std::vector<int> total;
+	for (auto lo : los) {
+		bytes.push_back(obs_output_get_total_bytes(lo->output));
+		dropped.push_back(obs_output_get_frames_dropped(lo->output));
+		total.push_back(obs_output_get_total_frames(lo->output));
+	}
+	uint64_t sustainStart = os_gettime_ns();
+	bool completed = Wait((uint64_t)durationSeconds * 1000);
+	double seconds = (double)(os_gettime_ns() - sustainStart) / 1000000000.0;
+
+	auto run = obs_data_create();
+	auto outputResults = obs_data_array_create();
+	double connectSum = 0.0;
+	double connectMax = 0.0;
+	int connected = 0;
+	double kbpsSum = 0.0;
+	for (size_t i = 0; i < los.size(); i++) {
+		auto lo = los[i];
+		auto r = obs_data_create();
+		obs_data_set_string(r, "name", lo->name.c_str());
+		double connect_ms = -1.0;
+		if (lo->connect_time) {
+			connect_ms = (double)(lo->connect_time - lo->start_time) / 1000000.0;
+			connectSum += connect_ms;
+			if (connect_ms > connectMax)
+				connectMax = connect_ms;
+			connected++;
+		}
+		double kbps = seconds > 0.0 ? (double)(obs_output_get_total_bytes(lo->output) - bytes[i]) * 8.0 / 1000.0 / seconds
+					    : 0.0;
+		kbpsSum += kbps;
+		if (completed && (!lo->connect_time || kbps <= 0.0))
+			failures++;
+		int droppedFrames = obs_output_get_frames_dropped(lo->output) - dropped[i];
+		int totalFrames = obs_output_get_total_frames(lo->output) - total[i];
+		obs_data_set_double(r, "connect_ms", connect_ms);
+		obs_data_set_double(r, "kbps", kbps);
+		obs_data_set_int(r, "dropped_frames", droppedFrames);
+		obs_data_set_int(r, "total_frames", totalFrames);
+		obs_data_array_push_back(outputResults, r);
+		obs_data_release(r);
+		progress("  " + lo->name + ": connect " + std::to_string((int)connect_ms) + "ms, " + std::to_string((int)kbps) +
+			 "Kbps, dropped frames " + std::to_string(droppedFrames) + "/" + std::to_string(totalFrames));
+	}
+	obs_data_set_int(run, "outputs", (long long)los.size());
+	obs_data_set_int(run, "connected", connected);
+	obs_data_set_int(run, "published", (long long)(sink.GetPublishCount() - sinkPublished));
+	obs_data_set_double(run, "avg_connect_ms", connected ? connectSum / connected : -1.0);
+	obs_data_set_double(run, "max_connect_ms", connected ? connectMax : -1.0);
+	obs_data_set_double(run, "total_kbps", kbpsSum);
+	obs_data_set_double(run, "sink_kbps",
+			    seconds > 0.0 ? (double)(sink.GetReceivedBytes() - sinkBytes) * 8.0 / 1000.0 / seconds : 0.0);
+	obs_data_set_array(run, "results", outputResults);
+	obs_data_array_release(outputResults);
+	obs_data_array_push_back(runs, run);
+	obs_data_release(run);
+
+	for (auto lo : los)
+		obs_output_stop(lo->output);
+	for (waited = 0; waited < 5000; waited += 50) {
+		bool active = false;
+		for (auto lo : los)
+			active = active || obs_output_active(lo->output);
+		if (!active)
+			break;
+		os_sleep_ms(50);
+	}
+	for (auto lo : los) {
+		signal_handler_disconnect(obs_output_get_signal_handler(lo->output), "start", loopback_output_start, lo);
+		if (obs_output_active(lo->output))
+			obs_output_force_stop(lo->output);
+		auto service = obs_output_get_service(lo->output);
+		obs_output_release(lo->output);
+		obs_service_release(service);
+		delete lo;
+	}
+	return completed && !los.empty();
+}
+
+static void loopback_stop(obs_output_t *output)
+{
+	obs_output_stop(output);
+	for (uint64_t waited = 0; waited < 5000 && obs_output_active(output); waited += 50)
+		os_sleep_ms(50);
+	if (obs_output_active(output))
+		obs_output_force_stop(output);
+}
+
+bool LoopbackTest::RunRecording(LoopbackSink &sink, obs_encoder_t *venc, obs_encoder_t *aenc, obs_data_t *results)
+{
+	progress("Loopback test: streaming and recording with the same encoders");
+	std::string server = "rtmp://127.0.0.1:" + std::to_string(sink.GetPort()) + "/live";
+	auto settings = obs_data_create();
+	obs_data_set_string(settings, "name", "loopback-record");
+	obs_data_set_string(settings, "stream_server", server.c_str());
+	obs_data_set_string(settings, "stream_key", "loopback-record");
+	obs_data_set_string(settings, "record_format", "mkv");
+	auto output = create_stream_output(settings, nullptr);
+	auto record = output ? create_record_output(settings, nullptr, recordDir.c_str()) : nullptr;
+	obs_data_release(settings);
+
+	bool completed = true;
+	int64_t size = 0;
+	if (record) {
+		obs_output_set_video_encoder(output, venc);
+		obs_output_set_audio_encoder(output, aenc, 0);
+		obs_output_set_video_encoder(record, venc);
+		obs_output_set_audio_encoder(record, aenc, 0);
+		bool started = obs_output_start(output) && obs_output_start(record);
+		completed = Wait((uint64_t)durationSeconds * 1000);
+		loopback_stop(record);
+		loopback_stop(output);
+		auto record_settings = obs_output_get_settings(record);
+		if (started)
+			size = os_get_file_size(obs_data_get_string(record_settings, "path"));
+		obs_data_release(record_settings);
+	}
+	obs_output_release(record);
+	if (output) {
+		auto service = obs_output_get_service(output);
+		obs_output_release(output);
+		obs_service_release(service);
+	}
+
+	obs_data_set_int(results, "recorded_bytes", size);
+	if (!completed)
+		return false;
+	if (size <= 0) {
+		progress("Loopback test: recording failed");
+		failures++;
+	} else {
+		progress("  loopback-record: recorded " + std::to_string(size) + " bytes");
+	}
+	return true;
+}
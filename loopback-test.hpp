@@ -0,0 +1,72 @@
+#pragma once
+
+#include <obs.h>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Local RTMP ingest on 127.0.0.1. Answers the handshake, connect, createStream and publish of any number of
+// connections and discards the media that follows.
+class LoopbackSink {
+public:
+	LoopbackSink();
+	~LoopbackSink();
+
+	bool Start();
+	void Stop();
+
+	int GetPort() const { return port; }
+	uint64_t GetReceivedBytes() const { return receivedBytes; }
+	size_t GetConnectionCount() const { return connectionCount; }
+	size_t GetPublishCount() const { return publishCount; }
+
+private:
+	intptr_t listenSocket;
+	int port = 0;
+	std::thread thread;
+	std::atomic<bool> running = false;
+	std::atomic<uint64_t> receivedBytes = 0;
+	std::atomic<size_t> connectionCount = 0;
+	std::atomic<size_t> publishCount = 0;
+
+	void Run();
+};
+
+// Starts growing sets of synthetic destinations through create_stream_output against a LoopbackSink and measures time
+// to connect, throughput and dropped frames per output. Runs on its own thread, results are saved as JSON to resultsPath.
+// The troubleshooter runs it on the OBS canvas, the loopback test target on a synthetic video output. With a recordDir
+// one more destination also records with the stream's encoders, the way the stream and record mode does.
+class LoopbackTest {
+public:
+	typedef std::function<void(const std::string &line)> progress_cb;
+
+	LoopbackTest(video_t *video, audio_t *audio, int maxOutputs, int durationSeconds, std::string resultsPath,
+		     std::string recordDir, progress_cb progress, std::function<void()> finished);
+	~LoopbackTest();
+
+	bool Running() const { return running; }
+	void Abort();
+	// Outputs that failed to start, connect or send, counted over all rounds
+	int GetFailures() const { return failures; }
+
+private:
+	video_t *video;
+	audio_t *audio;
+	int maxOutputs;
+	int durationSeconds;
+	std::string resultsPath;
+	std::string recordDir;
+	progress_cb progress;
+	std::function<void()> finished;
+	std::thread thread;
+	std::atomic<bool> running = true;
+	std::atomic<bool> aborted = false;
+	std::atomic<int> failures = 0;
+
+	void Run();
+	bool RunRound(LoopbackSink &sink, obs_encoder_t *venc, obs_encoder_t *aenc, int count, obs_data_array_t *runs);
+	bool RunRecording(LoopbackSink &sink, obs_encoder_t *venc, obs_encoder_t *aenc, obs_data_t *results);
+	bool Wait(uint64_t ms);
+};
@@ -1,6 +1,12 @@
+#include "abr-controller.hpp"
+#include "capacity-planner.hpp"
 #include "config-utils.hpp"
 #include "multistream.hpp"
 #include "obs-module.h"
+#include "plugin-api.hpp"
+#include "settings-diff.hpp"
+#include "stream-output.hpp"
+#include "trace.hpp"
 #include "version.h"
 #include <obs-frontend-api.h>
 #include <QDesktopServices>
@@ -10,9 +16,12 @@
 #include <QMessageBox>
 #include <QPushButton>
 #include <QScrollArea>
+#include <QUuid>
 #include <QVBoxLayout>
 #include <util/config-file.h>
 #include <util/platform.h>
+#include <algorithm>
+#include <set>
 
 extern "C" {
 #include "file-updater.h"
@@ -45,9 +54,12 @@ bool obs_module_load(void)
 {
 	blog(LOG_INFO, "[Aitum-Multistream] loaded version %s", PROJECT_VERSION);
 
+	CapacityBenchmark::RegisterOutput();
+
 	const auto main_window = static_cast<QMainWindow *>(obs_frontend_get_main_window());
 	multistream_dock = new MultistreamDock(main_window);
 	obs_frontend_add_dock_by_id("AitumMultistreamDock", obs_module_text("AitumMultistream"), multistream_dock);
+	plugin_api_register(multistream_dock);
 
 	version_update_info = update_info_create_single("[Aitum Multistream]", "OBS", "https://api.aitum.tv/plugin/multi",
 							version_info_downloaded, nullptr);
@@ -56,8 +68,11 @@ bool obs_module_load(void)
 
 void obs_module_post_load()
 {
-	if (multistream_dock)
+	if (multistream_dock) {
 		multistream_dock->LoadVerticalOutputs(true);
+		multistream_dock->RecoverLiveOutputs();
+	}
+	plugin_api_register_vendor();
 }
 
 void obs_module_unload()
@@ -66,6 +81,7 @@ void obs_module_unload()
 		update_info_destroy(version_update_info);
 		version_update_info = nullptr;
 	}
+	plugin_api_unregister();
 	if (multistream_dock) {
 		delete multistream_dock;
 	}
@@ -121,6 +137,36 @@ auto outputGroupStyle = QString("background-color: %1; padding: 0px;")
 
 auto outputPlatformIconSize = 36;
 
+// Platforms the filter offers, key as in ConfigUtils::getPlatformFromEndpoint and the name shown
+static const char *filter_platforms[][2] = {
+	{"twitch", "Twitch"},
+	{"youtube", "YouTube"},
+	{"kick", "Kick"},
+	{"tiktok", "TikTok"},
+	{"twitter", "X"},
+	{"trovo", "Trovo"},
+	{"facebook", "Facebook"},
+};
+
+// The lists do not scroll themselves, they take the height of their rows and the dock scrolls. Only the rows in view
+// get painted.
+static QListView *create_output_list(QAbstractItemModel *model, QAbstractItemDelegate *delegate)
+{
+	auto list = new QListView;
+	list->setModel(model);
+	list->setItemDelegate(delegate);
+	list->setUniformItemSizes(true);
+	list->setSelectionMode(QAbstractItemView::NoSelection);
+	list->setFocusPolicy(Qt::NoFocus);
+	list->setFrameShape(QFrame::NoFrame);
+	list->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+	list->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+	list->setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Fixed);
+	list->viewport()->setAutoFillBackground(false);
+	list->setFixedHeight(0);
+	return list;
+}
+
 // For showing warning for no vertical integration
 void showVerticalWarning(QVBoxLayout *verticalLayout)
 {
@@ -178,13 +224,15 @@ config_t *get_user_config(void)
 #endif
 }
 
-MultistreamDock::MultistreamDock(QWidget *parent) : QFrame(parent)
+MultistreamDock::MultistreamDock(QWidget *parent, bool live) : QFrame(parent), live(live)
 {
 	// Main layout
 	mainLayout = new QVBoxLayout;
 	mainLayout->setContentsMargins(0, 0, 0, 0);
 	setLayout(mainLayout);
 
+	lifecycle = new OutputLifecycle;
+
 	auto t = new QWidget;
 	auto tl = new QVBoxLayout;
 	tl->setSpacing(8); // between canvas groups
@@ -286,6 +334,16 @@ MultistreamDock::MultistreamDock(QWidget *parent) : QFrame(parent)
 
 	mainCanvasOutputLayout->addWidget(mainStreamGroup);
 
+	// Destinations are rows of a model painted by a delegate, the built-in stream above stays a widget
+	mainRows = new OutputListModel(this);
+	mainFilter = new OutputFilterModel(this);
+	mainFilter->setSourceModel(mainRows);
+	auto mainDelegate = new OutputRowDelegate(streamActiveIcon, streamInactiveIcon, this);
+	connect(mainDelegate, &OutputRowDelegate::buttonClicked, this,
+		[this](const QString &key) { OutputButtonClicked(key, false); });
+	mainList = create_output_list(mainFilter, mainDelegate);
+	mainCanvasOutputLayout->addWidget(mainList);
+
 	mainCanvasLayout->addLayout(mainCanvasOutputLayout);
 	mainCanvasGroup->setLayout(mainCanvasLayout);
 
@@ -316,6 +374,51 @@ MultistreamDock::MultistreamDock(QWidget *parent) : QFrame(parent)
 
 	verticalCanvasLayout->addLayout(verticalCanvasOutputLayout); // Add output layout to parent
 
+	verticalRows = new OutputListModel(this);
+	verticalFilter = new OutputFilterModel(this);
+	verticalFilter->setSourceModel(verticalRows);
+	auto verticalDelegate = new OutputRowDelegate(streamActiveIcon, streamInactiveIcon, this);
+	connect(verticalDelegate, &OutputRowDelegate::buttonClicked, this,
+		[this](const QString &key) { OutputButtonClicked(key, true); });
+	verticalList = create_output_list(verticalFilter, verticalDelegate);
+	verticalCanvasOutputLayout->addWidget(verticalList);
+
+	for (auto filter : {mainFilter, verticalFilter}) {
+		connect(filter, &QAbstractItemModel::rowsInserted, this, &MultistreamDock::FitOutputLists);
+		connect(filter, &QAbstractItemModel::rowsRemoved, this, &MultistreamDock::FitOutputLists);
+		connect(filter, &QAbstractItemModel::modelReset, this, &MultistreamDock::FitOutputLists);
+		connect(filter, &QAbstractItemModel::layoutChanged, this, &MultistreamDock::FitOutputLists);
+	}
+
+	// Filter row, shown once there are enough destinations to need it
+	outputFilterRow = new QWidget;
+	auto outputFilterLayout = new QHBoxLayout;
+	outputFilterLayout->setContentsMargins(8, 4, 8, 0);
+	outputFilterLayout->setSpacing(4);
+	outputFilterText = new QLineEdit;
+	outputFilterText->setPlaceholderText(QString::fromUtf8(obs_module_text("FilterOutputs")));
+	outputFilterText->setClearButtonEnabled(true);
+	outputFilterLayout->addWidget(outputFilterText, 1);
+	outputFilterPlatform = new QComboBox;
+	outputFilterPlatform->addItem(QString::fromUtf8(obs_module_text("FilterAllPlatforms")), QString());
+	for (auto &platform : filter_platforms)
+		outputFilterPlatform->addItem(QIcon(QString::fromUtf8(":/aitum/media/%1.png").arg(QString::fromUtf8(platform[0]))),
+					      QString::fromUtf8(platform[1]), QString::fromUtf8(platform[0]));
+	outputFilterPlatform->addItem(QIcon(":/aitum/media/unknown.png"), QString::fromUtf8(obs_module_text("FilterOtherPlatform")),
+				      QString::fromUtf8("unknown"));
+	outputFilterLayout->addWidget(outputFilterPlatform);
+	outputFilterState = new QComboBox;
+	outputFilterState->addItem(QString::fromUtf8(obs_module_text("FilterAllStates")), OUTPUT_FILTER_ALL);
+	outputFilterState->addItem(QString::fromUtf8(obs_module_text("FilterLive")), OUTPUT_FILTER_LIVE);
+	outputFilterState->addItem(QString::fromUtf8(obs_module_text("FilterIdle")), OUTPUT_FILTER_IDLE);
+	outputFilterState->addItem(QString::fromUtf8(obs_module_text("FilterProblem")), OUTPUT_FILTER_PROBLEM);
+	outputFilterLayout->addWidget(outputFilterState);
+	outputFilterRow->setLayout(outputFilterLayout);
+	outputFilterRow->setVisible(false);
+	connect(outputFilterText, &QLineEdit::textChanged, this, &MultistreamDock::ApplyOutputFilter);
+	connect(outputFilterPlatform, &QComboBox::currentIndexChanged, this, &MultistreamDock::ApplyOutputFilter);
+	connect(outputFilterState, &QComboBox::currentIndexChanged, this, &MultistreamDock::ApplyOutputFilter);
+
 	//tl->addWidget(verticalCanvasGroup);
 	QScrollArea *scrollArea = new QScrollArea;
 	scrollArea->setWidget(t);
@@ -323,7 +426,14 @@ MultistreamDock::MultistreamDock(QWidget *parent) : QFrame(parent)
 	scrollArea->setLineWidth(0);
 	scrollArea->setFrameShape(QFrame::NoFrame);
 	scrollArea->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-	mainLayout->addWidget(scrollArea, 1);
+
+	// One item in the main layout, the partner blocks are inserted after it
+	auto outputsLayout = new QVBoxLayout;
+	outputsLayout->setContentsMargins(0, 0, 0, 0);
+	outputsLayout->setSpacing(0);
+	outputsLayout->addWidget(outputFilterRow);
+	outputsLayout->addWidget(scrollArea, 1);
+	mainLayout->addLayout(outputsLayout, 1);
 
 	// Bottom Button Row
 	auto buttonRow = new QHBoxLayout;
@@ -342,22 +452,23 @@ MultistreamDock::MultistreamDock(QWidget *parent) : QFrame(parent)
 	QPushButton::connect(configButton, &QPushButton::clicked, [this] {
 		if (!configDialog)
 			configDialog = new OBSBasicSettings((QMainWindow *)obs_frontend_get_main_window());
-		auto settings = obs_data_create();
-		if (current_config)
-			obs_data_apply(settings, current_config);
+		// The dialog edits a deep copy, obs_data_apply would share the outputs array the rows point into
+		auto settings = settings_copy(current_config);
 		configDialog->LoadSettings(settings);
-		configDialog->LoadVerticalSettings(true);
+		configDialog->SetVerticalOutputs(vertical_outputs);
+		configDialog->LoadVerticalSettings();
 		configDialog->LoadOutputStats(&oldVideo);
+		configDialog->AppendTroubleshooterText(QString::fromUtf8(renditions.Report().c_str()));
 		configDialog->SetNewerVersion(newer_version_available);
 		configDialog->setResult(QDialog::Rejected);
 		if (configDialog->exec() == QDialog::Accepted) {
 			if (current_config) {
-				obs_data_apply(current_config, settings);
+				ApplySettingsChanges(settings);
 				obs_data_release(settings);
-				SaveSettings();
-				LoadSettings();
-				configDialog->SaveVerticalSettings();
-				LoadVerticalOutputs(false);
+				if (configDialog->VerticalOutputsChanged()) {
+					configDialog->SaveVerticalSettings();
+					LoadVerticalOutputs(false);
+				}
 			} else {
 				current_config = settings;
 			}
@@ -388,124 +499,149 @@ MultistreamDock::MultistreamDock(QWidget *parent) : QFrame(parent)
 
 	mainLayout->addLayout(buttonRow);
 
+	mainVideo = obs_get_video();
+	if (!live)
+		return;
+
 	obs_frontend_add_event_callback(frontend_event, this);
 
-	mainVideo = obs_get_video();
-	connect(&videoCheckTimer, &QTimer::timeout, [this] {
-		if (exiting)
-			return;
-		if (obs_get_video() != mainVideo) {
-			oldVideo.push_back(mainVideo);
-			mainVideo = obs_get_video();
-			for (auto it = outputs.begin(); it != outputs.end(); it++) {
-				auto venc = obs_output_get_video_encoder(std::get<obs_output_t *>(*it));
-				if (venc && !obs_encoder_active(venc))
-					obs_encoder_set_video(venc, mainVideo);
-			}
-		}
+	connect(&videoCheckTimer, &QTimer::timeout, this, &MultistreamDock::VideoCheckTick);
+	videoCheckTimer.start(500);
+	connect(&followMainTimer, &QTimer::timeout, this, &MultistreamDock::FollowMainTick);
+	scheduler = new OutputScheduler([this](const schedule_entry &entry) { PrepareScheduledStart(entry); },
+					[this](const schedule_entry &entry) { return RunSchedule(entry); });
+	connect(&scheduleTimer, &QTimer::timeout, [this] {
+		TRACE_SCOPE("ScheduleTick");
+		scheduler->Tick(time(nullptr));
+	});
+	scheduleTimer.start(1000);
+	LoadSettingsFile();
+}
 
-		auto service = obs_frontend_get_streaming_service();
-		auto url = QString::fromUtf8(service ? obs_service_get_connect_info(service, OBS_SERVICE_CONNECT_INFO_SERVER_URL)
-						     : "");
-		if (url != mainPlatformUrl) {
-			mainPlatformUrl = url;
-			mainPlatformIconLabel->setPixmap(ConfigUtils::getPlatformIconFromEndpoint(url).pixmap(
-				outputPlatformIconSize, outputPlatformIconSize));
-		}
+static long long output_bitrate(obs_output_t *output);
 
-		int idx = 0;
-		while (auto item = mainCanvasOutputLayout->itemAt(idx++)) {
-			auto streamGroup = item->widget();
-			if (idx == 1) {
-				auto active = obs_frontend_streaming_active();
-				foreach(QObject * c, streamGroup->children())
-				{
-					std::string cn = c->metaObject()->className();
-					if (cn == "QPushButton") {
-						auto pb = (QPushButton *)c;
-						if (pb->isChecked() != active) {
-							pb->setChecked(active);
-							outputButtonStyle(pb);
-						}
-					}
-				}
-				continue;
-			}
-			std::string name = streamGroup->objectName().toUtf8().constData();
-			if (name.empty())
-				continue;
-			for (auto it = outputs.begin(); it != outputs.end(); it++) {
-				if (std::get<std::string>(*it) != name)
-					continue;
+#define BUDGET_ALLOCATE_TICKS 10
+// The vertical plugin has no signal for a new output or changed settings, both are picked up within this many ticks
+#define VERTICAL_RESOLVE_TICKS 10
 
-				auto active = obs_output_active(std::get<obs_output_t *>(*it));
-				foreach(QObject * c, streamGroup->children())
-				{
-					std::string cn = c->metaObject()->className();
-					if (cn == "QPushButton") {
-						auto pb = (QPushButton *)c;
-						if (pb->isChecked() != active) {
-							pb->setChecked(active);
-							outputButtonStyle(pb);
-						}
-					}
-				}
-			}
-		}
-		auto ph = obs_get_proc_handler();
-		struct calldata cd;
-		calldata_init(&cd);
-		idx = 0;
-		while (auto item = verticalCanvasOutputLayout->itemAt(idx++)) {
-			auto streamGroup = item->widget();
-			std::string name = streamGroup->objectName().toUtf8().constData();
-			if (name.empty())
-				continue;
-			obs_output_t *output = nullptr;
-			calldata_set_string(&cd, "name", name.c_str());
-			if (proc_handler_call(ph, "aitum_vertical_get_stream_output", &cd)) {
-				output = (obs_output_t *)calldata_ptr(&cd, "output");
-			}
-			bool active = obs_output_active(output);
-			obs_output_release(output);
-			foreach(QObject * c, streamGroup->children())
-			{
-				std::string cn = c->metaObject()->className();
-				if (cn == "QPushButton") {
-					auto pb = (QPushButton *)c;
-					if (pb->isChecked() != active) {
-						pb->setChecked(active);
-						outputButtonStyle(pb);
-					}
-				}
-			}
+void MultistreamDock::VideoCheckTick()
+{
+	TRACE_SCOPE("VideoCheckTick");
+	if (exiting)
+		return;
+	if (obs_get_video() != mainVideo) {
+		oldVideo.push_back(mainVideo);
+		mainVideo = obs_get_video();
+		for (auto it = outputs.begin(); it != outputs.end(); it++) {
+			auto venc = obs_output_get_video_encoder(std::get<obs_output_t *>(*it));
+			if (venc && !obs_encoder_active(venc))
+				obs_encoder_set_video(venc, mainVideo);
 		}
-		calldata_free(&cd);
-	});
-	videoCheckTimer.start(500);
-	LoadSettingsFile();
+	}
+
+	for (auto it = abrControllers.begin(); it != abrControllers.end(); it++)
+		it->second->Tick();
+
+	auto main_output = obs_frontend_get_streaming_output();
+	if (obs_output_active(main_output))
+		bandwidthBudget.Sample(obs_output_get_name(main_output), main_output, output_bitrate(main_output));
+	obs_output_release(main_output);
+	for (auto it = outputs.begin(); it != outputs.end(); it++) {
+		auto output = std::get<obs_output_t *>(*it);
+		if (obs_output_active(output) && strcmp(obs_output_get_id(output), "ffmpeg_muxer") != 0 &&
+		    strcmp(obs_output_get_id(output), "mp4_output") != 0)
+			bandwidthBudget.Sample(obs_output_get_name(output), output, output_bitrate(output));
+	}
+
+	auto service = obs_frontend_get_streaming_service();
+	auto url = QString::fromUtf8(service ? obs_service_get_connect_info(service, OBS_SERVICE_CONNECT_INFO_SERVER_URL) : "");
+	if (url != mainPlatformUrl) {
+		mainPlatformUrl = url;
+		mainPlatformIconLabel->setPixmap(
+			ConfigUtils::getPlatformIconFromEndpoint(url).pixmap(outputPlatformIconSize, outputPlatformIconSize));
+	}
+
+	const bool main_active = obs_frontend_streaming_active();
+	if (mainStreamButton->isChecked() != main_active) {
+		mainStreamButton->setChecked(main_active);
+		outputButtonStyle(mainStreamButton);
+	}
+	for (auto it = outputs.begin(); it != outputs.end(); it++) {
+		auto row = mainRows->Find(QString::fromUtf8(std::get<std::string>(*it).c_str()));
+		mainRows->SetChecked(row, obs_output_active(std::get<obs_output_t *>(*it)));
+	}
+	// Vertical buttons follow the start and stop signals, only the bandwidth needs sampling
+	for (auto it = verticalOutputs.begin(); it != verticalOutputs.end(); it++) {
+		auto output = obs_weak_output_get_output(it->second);
+		if (obs_output_active(output))
+			bandwidthBudget.Sample(obs_output_get_name(output), output, output_bitrate(output));
+		obs_output_release(output);
+	}
+	if (++verticalResolveTicks >= VERTICAL_RESOLVE_TICKS) {
+		verticalResolveTicks = 0;
+		if (live)
+			RefreshVerticalOutputs();
+		ResolveVerticalOutputs();
+	}
+
+	bandwidthBudget.EndTick();
+	auto budget = obs_data_get_int(current_config, "upload_budget");
+	bool over_budget = budget > 0 && bandwidthBudget.GetUsage() > budget;
+	if (over_budget != overBudget) {
+		overBudget = over_budget;
+		if (over_budget)
+			blog(LOG_WARNING, "[Aitum Multistream] upload of %lld Kbps is over the budget of %lld Kbps",
+			     bandwidthBudget.GetUsage(), budget);
+	}
+	if (++budgetTicks >= BUDGET_ALLOCATE_TICKS) {
+		budgetTicks = 0;
+		bandwidthBudget.Allocate(budget, abrControllers);
+	}
 }
 
+#define SHUTDOWN_TIMEOUT_MS 5000
+
 MultistreamDock::~MultistreamDock()
 {
 	videoCheckTimer.stop();
+	followMainTimer.stop();
+	scheduleTimer.stop();
+	ReleaseVerticalOutputs();
+	delete scheduler;
+	UnregisterHotkeys(false);
+	obs_data_release(hotkeyBindings);
+	for (auto it = abrControllers.begin(); it != abrControllers.end(); it++)
+		delete it->second;
+	abrControllers.clear();
+
+	// All outputs stop in parallel against one deadline, so exit time does not grow with the number of outputs
+	uint64_t deadline = os_gettime_ns() + SHUTDOWN_TIMEOUT_MS * 1000000ULL;
+	std::vector<obs_output_t *> stopping;
+	for (auto it = recordOutputs.begin(); it != recordOutputs.end(); it++) {
+		signal_handler_disconnect(obs_output_get_signal_handler(it->second), "stop", record_output_stop, this);
+		stopping.push_back(it->second);
+	}
+	recordOutputs.clear();
 	for (auto it = outputs.begin(); it != outputs.end(); it++) {
 		auto old = std::get<obs_output_t *>(*it);
 		signal_handler_t *signal = obs_output_get_signal_handler(old);
 		signal_handler_disconnect(signal, "start", stream_output_start, this);
 		signal_handler_disconnect(signal, "stop", stream_output_stop, this);
-		auto service = obs_output_get_service(old);
-		if (obs_output_active(old)) {
-			obs_output_force_stop(old);
-		}
-		if (!exiting)
-			obs_output_release(old);
-		obs_service_release(service);
+		stopping.push_back(old);
 	}
+	OutputLifecycle::ForceStopAll(stopping, !exiting, deadline);
+	if (!lifecycle->WaitIdle(deadline))
+		blog(LOG_WARNING, "[Aitum Multistream] output stop still running at the shutdown deadline");
+	delete lifecycle;
+	lifecycle = nullptr;
 	outputs.clear();
 	obs_data_array_release(vertical_outputs);
 	obs_data_release(current_config);
-	obs_frontend_remove_event_callback(frontend_event, this);
+	if (live)
+		obs_frontend_remove_event_callback(frontend_event, this);
+	delete preflightProbe;
+	for (auto probe : retiredPreflightProbes)
+		delete probe;
 	multistream_dock = nullptr;
 }
 
@@ -514,9 +650,12 @@ void MultistreamDock::frontend_event(enum obs_frontend_event event, void *privat
 	auto md = (MultistreamDock *)private_data;
 	if (event == OBS_FRONTEND_EVENT_PROFILE_CHANGED || event == OBS_FRONTEND_EVENT_FINISHED_LOADING) {
 		md->LoadSettingsFile();
+		if (event == OBS_FRONTEND_EVENT_FINISHED_LOADING)
+			md->ResumeLiveOutputs();
 	} else if (event == OBS_FRONTEND_EVENT_PROFILE_CHANGING || event == OBS_FRONTEND_EVENT_PROFILE_RENAMED) {
 		md->SaveSettings();
 	} else if (event == OBS_FRONTEND_EVENT_EXIT) {
+		md->liveJournal.Close();
 		md->SaveSettings();
 		md->exiting = true;
 	} else if (event == OBS_FRONTEND_EVENT_STREAMING_STARTING || event == OBS_FRONTEND_EVENT_STREAMING_STARTED) {
@@ -524,15 +663,29 @@ void MultistreamDock::frontend_event(enum obs_frontend_event event, void *privat
 		md->outputButtonStyle(md->mainStreamButton);
 		md->mainStreamButton->setIcon(md->streamActiveIcon);
 		md->storeMainStreamEncoders();
+		if (event == OBS_FRONTEND_EVENT_STREAMING_STARTED) {
+			md->RunPreflight(false);
+			md->scheduler->MainStarted(time(nullptr));
+			md->StartFollowers();
+		}
 	} else if (event == OBS_FRONTEND_EVENT_STREAMING_STOPPING || event == OBS_FRONTEND_EVENT_STREAMING_STOPPED) {
 		md->mainStreamButton->setChecked(false);
 		md->outputButtonStyle(md->mainStreamButton);
+		// Followers use the main encoders, stop them before those go away
+		md->StopFollowers();
+		md->scheduler->MainStopped();
+		if (event == OBS_FRONTEND_EVENT_STREAMING_STOPPED)
+			md->RunPreflight(false);
 	}
 }
 
 void MultistreamDock::LoadSettingsFile()
 {
+	TRACE_SCOPE("LoadSettingsFile");
 	char *profile = obs_frontend_get_current_profile();
+	// No profile without the OBS frontend
+	if (!profile)
+		return;
 	if (current_config && strcmp(obs_data_get_string(current_config, "name"), profile) == 0) {
 		bfree(profile);
 		return;
@@ -576,188 +729,535 @@ void MultistreamDock::LoadSettingsFile()
 		obs_data_set_string(current_config, "name", profile);
 		bfree(profile);
 		blog(LOG_INFO, "[Aitum Multistream] profile not found");
+		LoadHotkeyBindings();
 		LoadSettings();
 		return;
 	}
 	bfree(profile);
 	current_config = pd;
+	LoadHotkeyBindings();
 	LoadSettings();
 }
 
 void MultistreamDock::LoadSettings()
 {
-
+	TRACE_SCOPE("LoadSettings");
 	auto outputs2 = obs_data_get_array(current_config, "outputs");
-	int idx = 1;
-	while (auto item = mainCanvasOutputLayout->itemAt(idx)) {
-		auto streamGroup = item->widget();
-		mainCanvasOutputLayout->removeWidget(streamGroup);
-		RemoveWidget(streamGroup);
-	}
-
-	obs_data_array_enum(
-		outputs2,
-		[](obs_data_t *data2, void *param) {
-			auto d = (MultistreamDock *)param;
-			d->LoadOutput(data2, false);
-		},
-		this);
+	// Older configurations have no ids, duplicates come from hand edited files
+	std::set<std::string> ids;
+	size_t count = obs_data_array_count(outputs2);
+	for (size_t i = 0; i < count; i++) {
+		auto settings = obs_data_array_item(outputs2, i);
+		if (!ids.insert(obs_data_get_string(settings, "id")).second || !*obs_data_get_string(settings, "id")) {
+			auto id = QUuid::createUuid().toString(QUuid::WithoutBraces).toStdString();
+			obs_data_set_string(settings, "id", id.c_str());
+			ids.insert(id);
+		}
+		obs_data_release(settings);
+	}
+	SyncOutputRows(outputs2, false);
 	obs_data_array_release(outputs2);
+	if (live) {
+		LoadHotkeys();
+		LoadSchedules();
+	}
+	RunPreflight(live && obs_data_get_bool(current_config, "preflight_probe"));
 }
 
-void MultistreamDock::LoadOutput(obs_data_t *output_data, bool vertical)
+static const char *output_row_key(obs_data_t *settings, bool vertical)
 {
-	auto nameChars = obs_data_get_string(output_data, "name");
-	auto name = QString::fromUtf8(nameChars);
-	if (vertical) {
-		for (int i = 0; i < verticalCanvasOutputLayout->count(); i++) {
-			auto item = verticalCanvasOutputLayout->itemAt(i);
-			auto oName = item->widget()->objectName();
-			if (oName == name) {
-				return;
-			}
+	return obs_data_get_string(settings, vertical ? "name" : "id");
+}
+
+static void fill_output_row(output_row &row, obs_data_t *settings, bool vertical)
+{
+	auto endpoint = QString::fromUtf8(obs_data_get_string(settings, "stream_server"));
+	row.key = output_row_key(settings, vertical);
+	row.name = QString::fromUtf8(obs_data_get_string(settings, "name"));
+	row.platform = ConfigUtils::getPlatformFromEndpoint(endpoint);
+	row.icon = ConfigUtils::getPlatformIconFromEndpoint(endpoint);
+	row.settings = QString::fromUtf8(obs_data_get_json(settings));
+	row.badge = preflight_validate(settings, vertical);
+}
+
+// Matches the rows to the outputs by id, or by name on the vertical canvas where the vertical plugin owns the settings.
+// Only new outputs get a row, removed ones lose theirs and the rest are updated in place so live rows keep their state.
+void MultistreamDock::SyncOutputRows(obs_data_array_t *outputs2, bool vertical)
+{
+	TRACE_SCOPE("SyncOutputRows");
+	auto rows = OutputRows(vertical);
+	std::set<std::string> keys;
+	size_t count = obs_data_array_count(outputs2);
+	for (size_t i = 0; i < count; i++) {
+		auto settings = obs_data_array_item(outputs2, i);
+		keys.insert(output_row_key(settings, vertical));
+		obs_data_release(settings);
+	}
+	std::set<std::string> kept;
+	for (int i = rows->rowCount() - 1; i >= 0; i--) {
+		std::string key = rows->Row(i).key;
+		if (!keys.count(key) || !kept.insert(key).second)
+			RemoveOutputRow(i, vertical);
+	}
+	for (size_t i = 0; i < count; i++) {
+		auto settings = obs_data_array_item(outputs2, i);
+		const int index = (int)i;
+		// Rows before index are in place already, a match there is a duplicate key
+		auto row = rows->FindKey(output_row_key(settings, vertical));
+		if (row < index) {
+			LoadOutput(settings, vertical, index);
+		} else {
+			UpdateOutputRow(row, settings, vertical);
+			rows->Move(row, index);
 		}
-	} else {
-		for (int i = 1; i < mainCanvasOutputLayout->count(); i++) {
-			auto item = mainCanvasOutputLayout->itemAt(i);
-			auto oName = item->widget()->objectName();
-			if (oName == name) {
-				return;
-			}
+		obs_data_release(settings);
+	}
+}
+
+void MultistreamDock::RemoveOutputRow(int row, bool vertical)
+{
+	auto rows = OutputRows(vertical);
+	std::string name = rows->Row(row).name.toStdString();
+	if (!vertical) {
+		// The destination is gone from the settings, a live output of it is stopped
+		bool live = false;
+		for (auto &output : outputs)
+			live = live || std::get<std::string>(output) == name;
+		if (live) {
+			blog(LOG_INFO, "[Aitum Multistream] stopping '%s', it was removed", name.c_str());
+			StopOutput(name.c_str());
 		}
+		followPending.erase(std::remove(followPending.begin(), followPending.end(), name), followPending.end());
+	}
+	rows->Remove(row);
+}
+
+void MultistreamDock::RemoveOutputRows(bool vertical)
+{
+	auto rows = OutputRows(vertical);
+	while (rows->rowCount() > 0)
+		RemoveOutputRow(rows->rowCount() - 1, vertical);
+}
+
+// Brings a kept row in line with its settings, nothing is touched when they did not change
+void MultistreamDock::UpdateOutputRow(int row, obs_data_t *output_data, bool vertical)
+{
+	auto rows = OutputRows(vertical);
+	if (rows->Row(row).settings == QString::fromUtf8(obs_data_get_json(output_data)))
+		return;
+	output_row data = rows->Row(row);
+	auto name = QString::fromUtf8(obs_data_get_string(output_data, "name"));
+	if (data.name != name)
+		RenameOutput(data.name.toStdString(), name.toStdString());
+	fill_output_row(data, output_data, vertical);
+	if (!vertical && UpdateLiveOutput(output_data))
+		data.checked = true;
+	rows->Update(row, data);
+}
+
+template<typename T> static void rename_key(std::map<std::string, T> &map, const std::string &from, const std::string &to)
+{
+	auto it = map.find(from);
+	if (it == map.end())
+		return;
+	auto value = it->second;
+	map.erase(it);
+	map[to] = value;
+}
+
+// A live output follows its destination when that is renamed
+void MultistreamDock::RenameOutput(const std::string &from, const std::string &to)
+{
+	bool live = false;
+	for (auto &output : outputs) {
+		if (std::get<std::string>(output) != from)
+			continue;
+		std::get<std::string>(output) = to;
+		live = true;
 	}
-	auto streamButton = new QPushButton;
+	rename_key(abrControllers, from, to);
+	rename_key(recordOutputs, from, to);
+	std::replace(followPending.begin(), followPending.end(), from, to);
+	std::replace(followStarted.begin(), followStarted.end(), from, to);
+	if (live) {
+		liveJournal.Record(from, false, false);
+		liveJournal.Record(to, false, true);
+	}
+}
+
+// Pushes changed encoder settings to a running output of the destination, true when there is one
+bool MultistreamDock::UpdateLiveOutput(obs_data_t *output_data)
+{
+	bool live = false;
+	auto nameChars = obs_data_get_string(output_data, "name");
 	for (auto it = outputs.begin(); it != outputs.end(); it++) {
 		if (std::get<std::string>(*it) != nameChars)
 			continue;
-		if (obs_data_get_bool(output_data, "advanced")) {
-			auto output = std::get<obs_output_t *>(*it);
-			auto video_encoder = obs_output_get_video_encoder(output);
-			if (video_encoder &&
-			    strcmp(obs_encoder_get_id(video_encoder), obs_data_get_string(output_data, "video_encoder")) == 0) {
-				auto ves = obs_data_get_obj(output_data, "video_encoder_settings");
-				obs_encoder_update(video_encoder, ves);
-				obs_data_release(ves);
+		live = true;
+		if (!obs_data_get_bool(output_data, "advanced"))
+			continue;
+		auto output = std::get<obs_output_t *>(*it);
+		auto video_encoder = obs_output_get_video_encoder(output);
+		if (video_encoder &&
+		    strcmp(obs_encoder_get_id(video_encoder), obs_data_get_string(output_data, "video_encoder")) == 0) {
+			auto ves = obs_data_get_obj(output_data, "video_encoder_settings");
+			obs_encoder_update(video_encoder, ves);
+			obs_data_release(ves);
+		}
+		auto abr = abrControllers.find(nameChars);
+		if (abr != abrControllers.end())
+			abr->second->UpdateSettings(output_data);
+	}
+	return live;
+}
+
+// Settings of a main canvas output, owned by current_config like the ones the dock buttons use
+static obs_data_t *find_output_settings(obs_data_t *config, const std::string &id)
+{
+	obs_data_t *settings = nullptr;
+	auto main_outputs = obs_data_get_array(config, "outputs");
+	size_t count = obs_data_array_count(main_outputs);
+	for (size_t i = 0; i < count && !settings; i++) {
+		auto item = obs_data_array_item(main_outputs, i);
+		if (id == obs_data_get_string(item, "id"))
+			settings = item;
+		obs_data_release(item);
+	}
+	obs_data_array_release(main_outputs);
+	return settings;
+}
+
+// The main stream is live and its encoders produce packets that other outputs can share
+static bool main_encoders_ready()
+{
+	auto main_output = obs_frontend_get_streaming_output();
+	auto venc = obs_output_get_video_encoder(main_output);
+	bool ready = obs_output_active(main_output) && venc && obs_encoder_active(venc) &&
+		     obs_output_get_audio_encoder(main_output, 0);
+	obs_output_release(main_output);
+	return ready;
+}
+
+void MultistreamDock::LoadOutput(obs_data_t *output_data, bool vertical, int index)
+{
+	output_row row;
+	fill_output_row(row, output_data, vertical);
+	row.checked = !vertical && UpdateLiveOutput(output_data);
+	OutputRows(vertical)->Insert(index, row);
+}
+
+// The stream button of a row, it toggles like the checkable buttons the rows had when they were widgets
+void MultistreamDock::OutputButtonClicked(const QString &key, bool vertical)
+{
+	auto rows = OutputRows(vertical);
+	auto row = rows->FindKey(key.toStdString());
+	if (row < 0)
+		return;
+	const bool checked = !rows->Row(row).checked;
+	auto name = rows->Row(row).name;
+	std::string output_name = name.toStdString();
+	if (vertical) {
+		auto ph = obs_get_proc_handler();
+		struct calldata cd;
+		calldata_init(&cd);
+		calldata_set_string(&cd, "name", output_name.c_str());
+		auto config = get_user_config();
+		if (checked) {
+			bool start = true;
+			bool warnBeforeStreamStart = config_get_bool(config, "BasicWindow", "WarnBeforeStartingStream");
+			if (warnBeforeStreamStart && isVisible()) {
+				auto button = QMessageBox::question(
+					this, QString::fromUtf8(obs_frontend_get_locale_string("ConfirmStart.Title")),
+					QString::fromUtf8(obs_frontend_get_locale_string("ConfirmStart.Text")),
+					QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+				if (button == QMessageBox::No)
+					start = false;
+			}
+			if (start && proc_handler_call(ph, "aitum_vertical_start_stream_output", &cd)) {
+				liveJournal.Record(output_name, true, true);
+				obs_output_release(ResolveVerticalOutput(output_name));
+				SetOutputChecked(name, true, true);
+			}
+		} else {
+			bool stop = true;
+			bool warnBeforeStreamStop = config_get_bool(config, "BasicWindow", "WarnBeforeStoppingStream");
+			if (warnBeforeStreamStop && isVisible()) {
+				auto button = QMessageBox::question(
+					this, QString::fromUtf8(obs_frontend_get_locale_string("ConfirmStop.Title")),
+					QString::fromUtf8(obs_frontend_get_locale_string("ConfirmStop.Text")),
+					QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+				if (button == QMessageBox::No)
+					stop = false;
+			}
+			if (stop) {
+				proc_handler_call(ph, "aitum_vertical_stop_stream_output", &cd);
+				liveJournal.Record(output_name, true, false);
+				SetOutputChecked(name, true, false);
 			}
 		}
-		std::get<QPushButton *>(*it) = streamButton;
+		calldata_free(&cd);
+		return;
 	}
-	auto streamGroup = new QGroupBox;
-	streamGroup->setStyleSheet(outputGroupStyle);
-	streamGroup->setObjectName(name);
-	auto streamLayout = new QVBoxLayout;
 
-	auto l2 = new QHBoxLayout;
+	// The settings are looked up on every click, a settings change replaces them without replacing the row
+	auto output_data = find_output_settings(current_config, key.toStdString());
+	if (!output_data)
+		return;
+	if (checked) {
+		blog(LOG_INFO, "[Aitum Multistream] start stream clicked '%s'", output_name.c_str());
+		const bool follow = obs_data_get_bool(output_data, "follow_main");
+		if (follow && !main_encoders_ready()) {
+			// Asked now, the start after the main stream goes live runs unattended
+			if (ConfirmStart())
+				QueueFollower(output_name);
+		} else if (StartOutput(output_data, true)) {
+			SetOutputChecked(name, false, true);
+			if (follow)
+				followStarted.push_back(output_name);
+		}
+		return;
+	}
+	auto pending = std::find(followPending.begin(), followPending.end(), output_name);
+	if (pending != followPending.end()) {
+		// Never started, it was only waiting for the main stream
+		followPending.erase(pending);
+		SetPreflightBadge(name, false, preflight_validate(output_data, false));
+		SetOutputChecked(name, false, false);
+		return;
+	}
+	bool stop = true;
+	bool warnBeforeStreamStop = config_get_bool(get_user_config(), "BasicWindow", "WarnBeforeStoppingStream");
+	if (warnBeforeStreamStop && isVisible()) {
+		auto button = QMessageBox::question(this, QString::fromUtf8(obs_frontend_get_locale_string("ConfirmStop.Title")),
+						    QString::fromUtf8(obs_frontend_get_locale_string("ConfirmStop.Text")),
+						    QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+		if (button == QMessageBox::No)
+			stop = false;
+	}
+	if (stop) {
+		blog(LOG_INFO, "[Aitum Multistream] stop stream clicked '%s'", output_name.c_str());
+		StopOutput(output_name.c_str());
+		SetOutputChecked(name, false, false);
+	}
+}
+
+// Looked up by name, the row may have moved while a confirmation was open
+void MultistreamDock::SetOutputChecked(const QString &name, bool vertical, bool checked)
+{
+	auto rows = OutputRows(vertical);
+	rows->SetChecked(rows->Find(name), checked);
+}
 
-	auto endpoint = QString::fromUtf8(obs_data_get_string(output_data, "stream_server"));
-	auto platformIconLabel = new QLabel;
-	auto platformIcon = ConfigUtils::getPlatformIconFromEndpoint(endpoint);
+void MultistreamDock::ApplyOutputFilter()
+{
+	auto text = outputFilterText->text().trimmed();
+	auto platform = outputFilterPlatform->currentData().toString();
+	auto state = outputFilterState->currentData().toInt();
+	mainFilter->SetFilter(text, platform, state);
+	verticalFilter->SetFilter(text, platform, state);
+}
 
-	platformIconLabel->setPixmap(platformIcon.pixmap(outputPlatformIconSize, outputPlatformIconSize));
+void MultistreamDock::FitOutputLists()
+{
+	for (auto list : {mainList, verticalList})
+		list->setFixedHeight(list->model()->rowCount() * OUTPUT_ROW_HEIGHT);
+	// Shown once either section is long enough to need it, the filter then applies to both
+	const bool filter = mainRows->rowCount() >= OUTPUT_FILTER_MIN_ROWS || verticalRows->rowCount() >= OUTPUT_FILTER_MIN_ROWS;
+	if (filter == !outputFilterRow->isHidden())
+		return;
+	outputFilterRow->setVisible(filter);
+	if (!filter) {
+		// A hidden filter would still hide rows
+		outputFilterText->clear();
+		outputFilterPlatform->setCurrentIndex(0);
+		outputFilterState->setCurrentIndex(0);
+	}
+}
 
-	l2->addWidget(platformIconLabel);
+void MultistreamDock::QueueFollower(const std::string &name)
+{
+	if (std::find(followPending.begin(), followPending.end(), name) == followPending.end())
+		followPending.push_back(name);
+	auto row = FindOutputRow(QString::fromUtf8(name.c_str()), false);
+	mainRows->SetChecked(row, true);
+	mainRows->SetBadge(row, {PREFLIGHT_WARNING, obs_module_text("FollowMainWaiting")});
+	if (!followMainTimer.isActive())
+		followMainTimer.start(250);
+}
 
-	l2->addWidget(new QLabel(name), 1);
+void MultistreamDock::StartFollowers()
+{
+	auto main_outputs = obs_data_get_array(current_config, "outputs");
+	size_t count = obs_data_array_count(main_outputs);
+	for (size_t i = 0; i < count; i++) {
+		auto settings = obs_data_array_item(main_outputs, i);
+		std::string name = obs_data_get_string(settings, "name");
+		bool follow = obs_data_get_bool(settings, "follow_main");
+		obs_data_release(settings);
+		if (!follow)
+			continue;
+		auto output = GetOutput(name.c_str(), false);
+		const bool active = obs_output_active(output);
+		obs_output_release(output);
+		if (!active)
+			QueueFollower(name);
+	}
+	obs_data_array_release(main_outputs);
+	FollowMainTick();
+}
 
-	streamButton->setMinimumHeight(30);
-	streamButton->setObjectName(QStringLiteral("canvasStream"));
-	streamButton->setIcon(streamInactiveIcon);
-	streamButton->setCheckable(true);
-	streamButton->setChecked(false);
-	outputButtonStyle(streamButton);
+void MultistreamDock::FollowMainTick()
+{
+	TRACE_SCOPE("FollowMainTick");
+	if (followPending.empty()) {
+		followMainTimer.stop();
+		return;
+	}
+	if (!main_encoders_ready())
+		return;
+	followMainTimer.stop();
+	auto pending = std::move(followPending);
+	followPending.clear();
+	for (auto &name : pending) {
+		std::string error;
+		if (ApiStartOutput(name.c_str(), false, error)) {
+			followStarted.push_back(name);
+			continue;
+		}
+		blog(LOG_WARNING, "[Aitum Multistream] failed to start '%s' with the main stream: %s", name.c_str(), error.c_str());
+		SetOutputChecked(QString::fromUtf8(name.c_str()), false, false);
+	}
+}
 
-	if (vertical) {
-		std::string output_name = obs_data_get_string(output_data, "name");
-		connect(streamButton, &QPushButton::clicked, [this, streamButton, output_name] {
-			auto ph = obs_get_proc_handler();
-			struct calldata cd;
-			calldata_init(&cd);
-			calldata_set_string(&cd, "name", output_name.c_str());
-			auto config = get_user_config();
-			if (streamButton->isChecked()) {
-				bool start = true;
-				bool warnBeforeStreamStart = config_get_bool(config, "BasicWindow", "WarnBeforeStartingStream");
-				if (warnBeforeStreamStart && isVisible()) {
-					auto button = QMessageBox::question(
-						this, QString::fromUtf8(obs_frontend_get_locale_string("ConfirmStart.Title")),
-						QString::fromUtf8(obs_frontend_get_locale_string("ConfirmStart.Text")),
-						QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
-					if (button == QMessageBox::No)
-						start = false;
-				}
-				if (!start || !proc_handler_call(ph, "aitum_vertical_start_stream_output", &cd))
-					streamButton->setChecked(false);
-			} else {
-				bool stop = true;
-				bool warnBeforeStreamStop = config_get_bool(config, "BasicWindow", "WarnBeforeStoppingStream");
-				if (warnBeforeStreamStop && isVisible()) {
-					auto button = QMessageBox::question(
-						this, QString::fromUtf8(obs_frontend_get_locale_string("ConfirmStop.Title")),
-						QString::fromUtf8(obs_frontend_get_locale_string("ConfirmStop.Text")),
-						QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
-					if (button == QMessageBox::No)
-						stop = false;
-				}
-				if (stop) {
-					proc_handler_call(ph, "aitum_vertical_stop_stream_output", &cd);
-				} else {
-					streamButton->setChecked(true);
-				}
-			}
-			calldata_free(&cd);
+void MultistreamDock::StopFollowers()
+{
+	followMainTimer.stop();
+	for (auto &name : followPending) {
+		SetOutputChecked(QString::fromUtf8(name.c_str()), false, false);
+	}
+	followPending.clear();
+	// Every stop runs on a thread of its own, they are issued last started first
+	for (auto it = followStarted.rbegin(); it != followStarted.rend(); it++) {
+		blog(LOG_INFO, "[Aitum Multistream] stopping '%s' with the main stream", it->c_str());
+		StopOutput(it->c_str());
+	}
+	followStarted.clear();
+}
 
-			outputButtonStyle(streamButton);
-		});
-	} else {
-		connect(streamButton, &QPushButton::clicked, [this, streamButton, output_data] {
-			if (streamButton->isChecked()) {
-				blog(LOG_INFO, "[Aitum Multistream] start stream clicked '%s'",
-				     obs_data_get_string(output_data, "name"));
-				if (!StartOutput(output_data, streamButton))
-					streamButton->setChecked(false);
-			} else {
-				bool stop = true;
-				bool warnBeforeStreamStop =
-					config_get_bool(get_user_config(), "BasicWindow", "WarnBeforeStoppingStream");
-				if (warnBeforeStreamStop && isVisible()) {
-					auto button = QMessageBox::question(
-						this, QString::fromUtf8(obs_frontend_get_locale_string("ConfirmStop.Title")),
-						QString::fromUtf8(obs_frontend_get_locale_string("ConfirmStop.Text")),
-						QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
-					if (button == QMessageBox::No)
-						stop = false;
-				}
-				if (stop) {
-					blog(LOG_INFO, "[Aitum Multistream] stop stream clicked '%s'",
-					     obs_data_get_string(output_data, "name"));
-					const char *name2 = obs_data_get_string(output_data, "name");
-					for (auto it = outputs.begin(); it != outputs.end(); it++) {
-						if (std::get<std::string>(*it) != name2)
-							continue;
-
-						obs_queue_task(
-							OBS_TASK_GRAPHICS,
-							[](void *param) { obs_output_stop((obs_output_t *)param); },
-							std::get<obs_output *>(*it), false);
-					}
-				} else {
-					streamButton->setChecked(true);
-				}
-			}
-			outputButtonStyle(streamButton);
-		});
+void MultistreamDock::RecoverLiveOutputs()
+{
+	resumeOutputs = liveJournal.Recover();
+	if (!resumeOutputs.empty())
+		blog(LOG_WARNING, "[Aitum Multistream] %d output(s) were live when OBS stopped unexpectedly",
+		     (int)resumeOutputs.size());
+}
+
+void MultistreamDock::ResumeLiveOutputs()
+{
+	if (resumeOutputs.empty())
+		return;
+	auto resume = std::move(resumeOutputs);
+	resumeOutputs.clear();
+	// Settled now either way, resumed outputs are recorded again once they are live
+	for (auto &destination : resume)
+		liveJournal.Record(destination.first, destination.second, false);
+	if (!obs_data_get_bool(current_config, "resume_live_outputs")) {
+		QStringList names;
+		for (auto &destination : resume)
+			names.append(QString::fromUtf8(destination.first.c_str()));
+		auto button = QMessageBox::question(this, QString::fromUtf8(obs_module_text("ResumeLiveOutputsTitle")),
+						    QString::fromUtf8(obs_module_text("ResumeLiveOutputsText"))
+							    .arg(names.join(QString::fromUtf8("\n"))),
+						    QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
+		if (button == QMessageBox::No)
+			return;
 	}
-	//streamButton->setSizePolicy(sp2);
-	streamButton->setToolTip(QString::fromUtf8(obs_module_text("Stream")));
-	l2->addWidget(streamButton);
-	streamLayout->addLayout(l2);
+	// One pass over everything that was live
+	for (auto &destination : resume) {
+		blog(LOG_INFO, "[Aitum Multistream] resuming '%s'", destination.first.c_str());
+		StartOrQueue(destination.first, destination.second);
+	}
+}
 
-	streamGroup->setLayout(streamLayout);
+// Outputs on the main encoders wait for the main stream instead of failing
+void MultistreamDock::StartOrQueue(const std::string &name, bool vertical)
+{
+	bool uses_main = false;
+	auto main_outputs = vertical ? nullptr : obs_data_get_array(current_config, "outputs");
+	size_t count = obs_data_array_count(main_outputs);
+	for (size_t i = 0; i < count; i++) {
+		auto settings = obs_data_array_item(main_outputs, i);
+		if (name == obs_data_get_string(settings, "name"))
+			uses_main = !obs_data_get_bool(settings, "advanced") || !*obs_data_get_string(settings, "video_encoder") ||
+				    !*obs_data_get_string(settings, "audio_encoder");
+		obs_data_release(settings);
+	}
+	obs_data_array_release(main_outputs);
+	std::string error;
+	if (uses_main && !main_encoders_ready())
+		QueueFollower(name);
+	else if (!ApiStartOutput(name.c_str(), vertical, error))
+		blog(LOG_WARNING, "[Aitum Multistream] failed to start '%s': %s", name.c_str(), error.c_str());
+}
 
-	if (vertical)
-		verticalCanvasOutputLayout->addWidget(streamGroup);
-	else
-		mainCanvasOutputLayout->addWidget(streamGroup);
+void MultistreamDock::LoadSchedules()
+{
+	std::vector<schedule_entry> entries;
+	auto add = [&entries](obs_data_t *settings, bool vertical) {
+		std::string name = obs_data_get_string(settings, "name");
+		if (!schedule_parse(obs_data_get_string(settings, "schedule_start"), name, vertical, true, entries) ||
+		    !schedule_parse(obs_data_get_string(settings, "schedule_stop"), name, vertical, false, entries))
+			blog(LOG_WARNING, "[Aitum Multistream] invalid schedule for '%s'", name.c_str());
+	};
+	auto main_outputs = obs_data_get_array(current_config, "outputs");
+	for (size_t i = 0; i < obs_data_array_count(main_outputs); i++) {
+		auto settings = obs_data_array_item(main_outputs, i);
+		add(settings, false);
+		obs_data_release(settings);
+	}
+	obs_data_array_release(main_outputs);
+	for (size_t i = 0; i < obs_data_array_count(vertical_outputs); i++) {
+		auto settings = obs_data_array_item(vertical_outputs, i);
+		add(settings, true);
+		obs_data_release(settings);
+	}
+	auto lead = obs_data_has_user_value(current_config, "schedule_lead") ? obs_data_get_int(current_config, "schedule_lead")
+									     : SCHEDULE_DEFAULT_LEAD;
+	scheduler->Load(std::move(entries), (int)lead, time(nullptr));
+}
+
+void MultistreamDock::PrepareScheduledStart(const schedule_entry &entry)
+{
+	blog(LOG_INFO, "[Aitum Multistream] preparing scheduled start of '%s'", entry.name.c_str());
+	RunPreflight(true, std::string(entry.vertical ? "v" : "m") + entry.name);
+}
+
+bool MultistreamDock::RunSchedule(const schedule_entry &entry)
+{
+	if (!entry.start) {
+		std::string error;
+		if (!ApiStopOutput(entry.name.c_str(), entry.vertical, error))
+			blog(LOG_WARNING, "[Aitum Multistream] failed to stop '%s': %s", entry.name.c_str(), error.c_str());
+		return true;
+	}
+	// Stay out of the way while the main stream is going live
+	if (obs_frontend_streaming_active() && !main_encoders_ready())
+		return false;
+	StartOrQueue(entry.name, entry.vertical);
+	return true;
+}
+
+void MultistreamDock::StopOutput(const char *name)
+{
+	for (auto it = outputs.begin(); it != outputs.end(); it++) {
+		if (std::get<std::string>(*it) != name)
+			continue;
+
+		lifecycle->Stop(std::get<obs_output *>(*it));
+	}
+	auto record = recordOutputs.find(name);
+	if (record != recordOutputs.end())
+		lifecycle->Stop(record->second);
 }
 
 static void ensure_directory(char *path)
@@ -781,8 +1281,34 @@ static void ensure_directory(char *path)
 #endif
 }
 
+// Applies only the keys the dialog changed and refreshes what depends on them, accepting without changes costs nothing
+void MultistreamDock::ApplySettingsChanges(obs_data_t *settings)
+{
+	TRACE_SCOPE("ApplySettingsChanges");
+	auto changed = settings_changed_keys(current_config, settings);
+	// Hotkey bindings are edited in the OBS settings while the dialog is open, the copy it holds is stale
+	changed.erase(std::remove(changed.begin(), changed.end(), "hotkeys"), changed.end());
+	if (changed.empty())
+		return;
+	settings_apply_keys(current_config, settings, changed);
+	SaveSettings();
+	auto has = [&changed](const char *key) {
+		return std::find(changed.begin(), changed.end(), key) != changed.end();
+	};
+	if (has("outputs")) {
+		// Only the rows of changed outputs are touched
+		LoadSettings();
+		return;
+	}
+	if (has("schedule_lead"))
+		LoadSchedules();
+	if (has("preflight_probe"))
+		RunPreflight(obs_data_get_bool(current_config, "preflight_probe"));
+}
+
 void MultistreamDock::SaveSettings()
 {
+	TRACE_SCOPE("SaveSettings");
 	char *path = obs_module_config_path("config.json");
 	if (!path)
 		return;
@@ -793,6 +1319,10 @@ void MultistreamDock::SaveSettings()
 		blog(LOG_WARNING, "[Aitum Multistream] New configuration file");
 	}
 	obs_data_set_int(config, "partner_block", partnerBlockTime);
+	if (current_config && hotkeyBindings) {
+		SaveHotkeys();
+		obs_data_set_obj(current_config, "hotkeys", hotkeyBindings);
+	}
 	auto profiles = obs_data_get_array(config, "profiles");
 	if (!profiles) {
 		profiles = obs_data_array_create();
@@ -835,21 +1365,217 @@ void MultistreamDock::SaveSettings()
 	bfree(path);
 }
 
-bool MultistreamDock::StartOutput(obs_data_t *settings, QPushButton *streamButton)
+static std::vector<std::string> bind_addresses()
+{
+	std::vector<std::string> addresses;
+	auto props = obs_get_output_properties("rtmp_output");
+	auto p = obs_properties_get(props, "bind_ip");
+	size_t count = obs_property_list_item_count(p);
+	for (size_t i = 0; i < count; i++) {
+		auto address = obs_property_list_item_string(p, i);
+		if (address && *address && strcmp(address, "default") != 0)
+			addresses.push_back(address);
+	}
+	obs_properties_destroy(props);
+	return addresses;
+}
+
+static long long encoder_bitrate(obs_encoder_t *encoder)
+{
+	if (!encoder)
+		return 0;
+	auto settings = obs_encoder_get_settings(encoder);
+	auto bitrate = obs_data_get_int(settings, "bitrate");
+	obs_data_release(settings);
+	return bitrate;
+}
+
+static long long output_bitrate(obs_output_t *output)
+{
+	long long bitrate = 0;
+	for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++)
+		bitrate += encoder_bitrate(obs_output_get_video_encoder2(output, i));
+	for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++)
+		bitrate += encoder_bitrate(obs_output_get_audio_encoder(output, i));
+	return bitrate;
+}
+
+static bool is_ipv6_address(const std::string &address)
+{
+	return address.find(':') != std::string::npos;
+}
+
+static bool is_link_local_address(const std::string &address)
+{
+	if (is_ipv6_address(address))
+		return address.size() >= 4 && tolower(address[0]) == 'f' && tolower(address[1]) == 'e' &&
+		       strchr("89abAB", address[2]) != nullptr;
+	return address.compare(0, 8, "169.254.") == 0;
+}
+
+// Local address of the server's family carrying the least upload of the started outputs
+std::string MultistreamDock::PickBindIp(const char *server, const char *ip_family)
+{
+	// A host name goes over IPv4 unless the output is set to IPv6 only
+	stream_url url;
+	parse_stream_url(server, url);
+	bool ipv6 = is_ipv6_address(url.host) || (ip_family && strcmp(ip_family, "IPv6") == 0);
+	bool link_local = is_link_local_address(url.host);
+
+	std::vector<std::string> addresses;
+	std::map<std::string, long long> load;
+	for (auto &address : bind_addresses()) {
+		if (is_ipv6_address(address) != ipv6 || is_link_local_address(address) != link_local)
+			continue;
+		addresses.push_back(address);
+		load[address] = 0;
+	}
+	if (addresses.empty())
+		return "default";
+	// Outputs still connecting count too, so a batch of starts spreads over the addresses
+	for (auto it = outputs.begin(); it != outputs.end(); it++) {
+		auto output = std::get<obs_output_t *>(*it);
+		auto settings = obs_output_get_settings(output);
+		auto l = load.find(obs_data_get_string(settings, "bind_ip"));
+		if (l != load.end()) {
+			auto kbps = bandwidthBudget.GetKbps(obs_output_get_name(output));
+			l->second += kbps > 0 ? kbps : output_bitrate(output);
+		}
+		obs_data_release(settings);
+	}
+	auto best = addresses.front();
+	for (auto &address : addresses) {
+		if (load[address] < load[best])
+			best = address;
+	}
+	return best;
+}
+
+// Upload of an output that is not started yet, from its encoder settings or the main encoders it will use
+static long long estimate_bitrate(obs_data_t *settings)
+{
+	long long bitrate = 0;
+	const bool advanced = obs_data_get_bool(settings, "advanced");
+	auto main_output = obs_frontend_get_streaming_output();
+	if (advanced && *obs_data_get_string(settings, "video_encoder")) {
+		auto ves = obs_data_get_obj(settings, "video_encoder_settings");
+		auto video_bitrate = obs_data_get_int(ves, "bitrate");
+		obs_data_release(ves);
+		// Adaptive outputs can be squeezed down to their minimum
+		auto abr_min_bitrate = obs_data_get_int(settings, "abr_min_bitrate");
+		if (obs_data_get_bool(settings, "abr"))
+			video_bitrate = abr_min_bitrate > 0 ? abr_min_bitrate : video_bitrate / 4;
+		bitrate += video_bitrate;
+	} else {
+		auto vei = advanced ? obs_data_get_int(settings, "video_encoder_index") : 0;
+		auto indexes = advanced ? obs_data_get_int(settings, "video_encoder_indexes") : 0;
+		for (long long i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+			if (i == vei || (indexes & (1LL << i)))
+				bitrate += encoder_bitrate(obs_output_get_video_encoder2(main_output, (size_t)i));
+		}
+	}
+	if (advanced && *obs_data_get_string(settings, "audio_encoder")) {
+		auto aes = obs_data_get_obj(settings, "audio_encoder_settings");
+		auto audio_bitrate = obs_data_get_int(aes, "bitrate");
+		obs_data_release(aes);
+		bitrate += audio_bitrate;
+	} else {
+		bitrate += encoder_bitrate(obs_output_get_audio_encoder(main_output, 0));
+	}
+	auto audio_indexes = advanced ? obs_data_get_int(settings, "audio_encoder_indexes") : 0;
+	for (long long i = 1; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+		if (audio_indexes & (1LL << i))
+			bitrate += encoder_bitrate(obs_output_get_audio_encoder(main_output, (size_t)i));
+	}
+	obs_output_release(main_output);
+	return bitrate;
+}
+
+static void set_output_encoders(obs_output_t *output, obs_encoder_t *venc, obs_encoder_t *aenc,
+				const std::vector<obs_encoder_t *> &extra_video_encoders,
+				const std::vector<obs_encoder_t *> &extra_audio_encoders)
+{
+	obs_output_set_video_encoder(output, venc);
+	obs_output_set_audio_encoder(output, aenc, 0);
+	auto flags = obs_output_get_flags(output);
+	if (!extra_video_encoders.empty() && !(flags & OBS_OUTPUT_MULTI_TRACK_VIDEO)) {
+		blog(LOG_WARNING, "[Aitum Multistream] output '%s' does not support multiple video tracks",
+		     obs_output_get_name(output));
+	} else {
+		for (size_t i = 0; i < extra_video_encoders.size() && i + 1 < MAX_OUTPUT_VIDEO_ENCODERS; i++)
+			obs_output_set_video_encoder2(output, extra_video_encoders[i], i + 1);
+	}
+	if (!extra_audio_encoders.empty() && !(flags & OBS_OUTPUT_MULTI_TRACK_AUDIO)) {
+		blog(LOG_WARNING, "[Aitum Multistream] output '%s' does not support multiple audio tracks",
+		     obs_output_get_name(output));
+	} else {
+		for (size_t i = 0; i < extra_audio_encoders.size() && i + 1 < MAX_OUTPUT_AUDIO_ENCODERS; i++)
+			obs_output_set_audio_encoder(output, extra_audio_encoders[i], i + 1);
+	}
+}
+
+bool MultistreamDock::ConfirmStart()
 {
+	bool warnBeforeStreamStart = config_get_bool(get_user_config(), "BasicWindow", "WarnBeforeStartingStream");
+	if (!warnBeforeStreamStart || !isVisible())
+		return true;
+	auto button = QMessageBox::question(this, QString::fromUtf8(obs_frontend_get_locale_string("ConfirmStart.Title")),
+					    QString::fromUtf8(obs_frontend_get_locale_string("ConfirmStart.Text")),
+					    QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+	return button == QMessageBox::Yes;
+}
+
+bool MultistreamDock::StartOutput(obs_data_t *settings, bool confirm)
+{
+	TRACE_SCOPE("StartOutput");
 	if (!settings)
 		return false;
+	auto rowName = QString::fromUtf8(obs_data_get_string(settings, "name"));
 
-	bool warnBeforeStreamStart = config_get_bool(get_user_config(), "BasicWindow", "WarnBeforeStartingStream");
-	if (warnBeforeStreamStart && isVisible()) {
-		auto button = QMessageBox::question(this, QString::fromUtf8(obs_frontend_get_locale_string("ConfirmStart.Title")),
-						    QString::fromUtf8(obs_frontend_get_locale_string("ConfirmStart.Text")),
-						    QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
-		if (button == QMessageBox::No)
-			return false;
+	auto preflight = preflight_validate(settings, false);
+	SetPreflightBadge(rowName, false, preflight);
+	if (preflight.status == PREFLIGHT_ERROR) {
+		blog(LOG_WARNING, "[Aitum Multistream] failed to start stream '%s': %s", obs_data_get_string(settings, "name"),
+		     preflight.message.c_str());
+		return false;
+	}
+
+	auto budget = obs_data_get_int(current_config, "upload_budget");
+	long long estimate = 0;
+	if (budget > 0 && obs_data_get_int(settings, "record_mode") != RECORD_MODE_RECORD) {
+		estimate = estimate_bitrate(settings);
+		if (bandwidthBudget.GetUsage() + estimate > budget) {
+			const bool refuse = obs_data_get_int(current_config, "upload_budget_mode") == UPLOAD_BUDGET_REFUSE;
+			blog(LOG_WARNING,
+			     "[Aitum Multistream] %s stream '%s', %lld Kbps in use plus %lld Kbps is over the budget of %lld Kbps",
+			     refuse ? "refused" : "starting", obs_data_get_string(settings, "name"), bandwidthBudget.GetUsage(),
+			     estimate, budget);
+			SetPreflightBadge(rowName, false,
+					  {refuse ? PREFLIGHT_ERROR : PREFLIGHT_WARNING, obs_module_text("UploadBudgetExceeded")});
+			if (refuse)
+				return false;
+		}
 	}
 
+	// Only a click asks, hotkeys, the API, follow-main, schedules and resume start unattended
+	if (confirm && !ConfirmStart())
+		return false;
+
 	const char *name = obs_data_get_string(settings, "name");
+	auto abr = abrControllers.find(name);
+	if (abr != abrControllers.end()) {
+		delete abr->second;
+		abrControllers.erase(abr);
+	}
+	auto record = recordOutputs.find(name);
+	if (record != recordOutputs.end()) {
+		auto old = record->second;
+		recordOutputs.erase(record);
+		signal_handler_disconnect(obs_output_get_signal_handler(old), "stop", record_output_stop, this);
+		if (obs_output_active(old))
+			obs_output_force_stop(old);
+		obs_output_release(old);
+	}
 	for (auto it = outputs.begin(); it != outputs.end(); it++) {
 		if (std::get<std::string>(*it) != name)
 			continue;
@@ -863,8 +1589,18 @@ bool MultistreamDock::StartOutput(obs_data_t *settings, QPushButton *streamButto
 		outputs.erase(it);
 		break;
 	}
+	uint64_t phase = os_gettime_ns();
 	obs_encoder_t *venc = nullptr;
 	obs_encoder_t *aenc = nullptr;
+	bool custom_video_encoder = false;
+	bool custom_audio_encoder = false;
+	// Encoders created here are released again on every failure, nothing else holds them yet
+	auto release_encoders = [&] {
+		if (custom_video_encoder)
+			obs_encoder_release(venc);
+		if (custom_audio_encoder)
+			obs_encoder_release(aenc);
+	};
 	auto advanced = obs_data_get_bool(settings, "advanced");
 	if (advanced) {
 		auto venc_name = obs_data_get_string(settings, "video_encoder");
@@ -875,8 +1611,7 @@ bool MultistreamDock::StartOutput(obs_data_t *settings, QPushButton *streamButto
 				obs_output_release(main_output);
 				blog(LOG_WARNING, "[Aitum Multistream] failed to start stream '%s' because main was not started",
 				     obs_data_get_string(settings, "name"));
-				QMessageBox::warning(this, QString::fromUtf8(obs_module_text("MainOutputNotActive")),
-						     QString::fromUtf8(obs_module_text("MainOutputNotActive")));
+				SetPreflightBadge(rowName, false, {PREFLIGHT_ERROR, obs_module_text("MainOutputNotActive")});
 				return false;
 			}
 			auto vei = (int)obs_data_get_int(settings, "video_encoder_index");
@@ -886,8 +1621,8 @@ bool MultistreamDock::StartOutput(obs_data_t *settings, QPushButton *streamButto
 				blog(LOG_WARNING,
 				     "[Aitum Multistream] failed to start stream '%s' because encoder index %d was not found",
 				     obs_data_get_string(settings, "name"), vei);
-				QMessageBox::warning(this, QString::fromUtf8(obs_module_text("MainOutputEncoderIndexNotFound")),
-						     QString::fromUtf8(obs_module_text("MainOutputEncoderIndexNotFound")));
+				SetPreflightBadge(rowName, false,
+						  {PREFLIGHT_ERROR, obs_module_text("MainOutputEncoderIndexNotFound")});
 				return false;
 			}
 		} else {
@@ -902,17 +1637,13 @@ bool MultistreamDock::StartOutput(obs_data_t *settings, QPushButton *streamButto
 			video_encoder_name += name;
 			venc = obs_video_encoder_create(venc_name, video_encoder_name.c_str(), s, nullptr);
 			obs_data_release(s);
-			obs_encoder_set_video(venc, obs_get_video());
+			custom_video_encoder = true;
 			auto divisor = obs_data_get_int(settings, "frame_rate_divisor");
-			if (divisor > 1)
-				obs_encoder_set_frame_rate_divisor(venc, (uint32_t)divisor);
-
 			bool scale = obs_data_get_bool(settings, "scale");
-			if (scale) {
-				obs_encoder_set_scaled_size(venc, (uint32_t)obs_data_get_int(settings, "width"),
-							    (uint32_t)obs_data_get_int(settings, "height"));
-				obs_encoder_set_gpu_scale_type(venc, (obs_scale_type)obs_data_get_int(settings, "scale_type"));
-			}
+			renditions.Attach(venc, obs_get_video(), scale ? (uint32_t)obs_data_get_int(settings, "width") : 0,
+					  scale ? (uint32_t)obs_data_get_int(settings, "height") : 0,
+					  (obs_scale_type)obs_data_get_int(settings, "scale_type"),
+					  divisor > 1 ? (uint32_t)divisor : 1);
 		}
 		auto aenc_name = obs_data_get_string(settings, "audio_encoder");
 		if (!aenc_name || aenc_name[0] == '\0') {
@@ -922,8 +1653,8 @@ bool MultistreamDock::StartOutput(obs_data_t *settings, QPushButton *streamButto
 				obs_output_release(main_output);
 				blog(LOG_WARNING, "[Aitum Multistream] failed to start stream '%s' because main was not started",
 				     obs_data_get_string(settings, "name"));
-				QMessageBox::warning(this, QString::fromUtf8(obs_module_text("MainOutputNotActive")),
-						     QString::fromUtf8(obs_module_text("MainOutputNotActive")));
+				SetPreflightBadge(rowName, false, {PREFLIGHT_ERROR, obs_module_text("MainOutputNotActive")});
+				release_encoders();
 				return false;
 			}
 			auto aei = (int)obs_data_get_int(settings, "audio_encoder_index");
@@ -933,8 +1664,9 @@ bool MultistreamDock::StartOutput(obs_data_t *settings, QPushButton *streamButto
 				blog(LOG_WARNING,
 				     "[Aitum Multistream] failed to start stream '%s' because encoder index %d was not found",
 				     obs_data_get_string(settings, "name"), aei);
-				QMessageBox::warning(this, QString::fromUtf8(obs_module_text("MainOutputEncoderIndexNotFound")),
-						     QString::fromUtf8(obs_module_text("MainOutputEncoderIndexNotFound")));
+				SetPreflightBadge(rowName, false,
+						  {PREFLIGHT_ERROR, obs_module_text("MainOutputEncoderIndexNotFound")});
+				release_encoders();
 				return false;
 			}
 		} else {
@@ -950,6 +1682,7 @@ bool MultistreamDock::StartOutput(obs_data_t *settings, QPushButton *streamButto
 			aenc = obs_audio_encoder_create(aenc_name, audio_encoder_name.c_str(), s,
 							obs_data_get_int(settings, "audio_track"), nullptr);
 			obs_data_release(s);
+			custom_audio_encoder = true;
 			obs_encoder_set_audio(aenc, obs_get_audio());
 		}
 	} else {
@@ -959,8 +1692,7 @@ bool MultistreamDock::StartOutput(obs_data_t *settings, QPushButton *streamButto
 			obs_output_release(main_output);
 			blog(LOG_WARNING, "[Aitum Multistream] failed to start stream '%s' because main was not started",
 			     obs_data_get_string(settings, "name"));
-			QMessageBox::warning(this, QString::fromUtf8(obs_module_text("MainOutputNotActive")),
-					     QString::fromUtf8(obs_module_text("MainOutputNotActive")));
+			SetPreflightBadge(rowName, false, {PREFLIGHT_ERROR, obs_module_text("MainOutputNotActive")});
 			return false;
 		}
 
@@ -968,128 +1700,220 @@ bool MultistreamDock::StartOutput(obs_data_t *settings, QPushButton *streamButto
 		obs_output_release(main_output);
 	}
 	if (!aenc || !venc) {
+		release_encoders();
 		return false;
 	}
-	auto server = obs_data_get_string(settings, "stream_server");
-	if (!server || !strlen(server)) {
-		server = obs_data_get_string(settings, "server");
-		if (server && strlen(server))
-			obs_data_set_string(settings, "stream_server", server);
-	}
-	bool whip = strstr(server, "whip") != nullptr;
-	auto s = obs_data_create();
-	obs_data_set_string(s, "server", server);
-	auto key = obs_data_get_string(settings, "stream_key");
-	if (!key || !strlen(key)) {
-		key = obs_data_get_string(settings, "key");
-		if (key && strlen(key))
-			obs_data_set_string(settings, "stream_key", key);
-	}
-	if (whip) {
-		obs_data_set_string(s, "bearer_token", key);
-	} else {
-		obs_data_set_string(s, "key", key);
-	}
-	//use_auth
-	//username
-	//password
-	std::string service_name = "aitum_multi_service_";
-	service_name += name;
-	auto service = obs_service_create(whip ? "whip_custom" : "rtmp_custom", service_name.c_str(), s, nullptr);
-	obs_data_release(s);
-
-	const char *type = obs_service_get_preferred_output_type(service);
-	if (!type) {
-		type = "rtmp_output";
-		if (strncmp(server, "ftl", 3) == 0) {
-			type = "ftl_output";
-		} else if (strncmp(server, "rtmp", 4) != 0) {
-			type = "ffmpeg_mpegts_muxer";
+	trace_record("StartOutput.encoders", phase, os_gettime_ns());
+	phase = os_gettime_ns();
+
+	auto record_mode = obs_data_get_int(settings, "record_mode");
+	obs_output_t *output = nullptr;
+	if (record_mode != RECORD_MODE_RECORD) {
+		output = create_stream_output(settings, obs_frontend_get_profile_config());
+		if (!output) {
+			release_encoders();
+			return false;
+		}
+		if (strcmp(obs_data_get_string(settings, "bind_ip"), "auto") == 0) {
+			auto current = obs_output_get_settings(output);
+			auto bind_ip = PickBindIp(obs_data_get_string(settings, "stream_server"),
+						  obs_data_get_string(current, "ip_family"));
+			obs_data_release(current);
+			blog(LOG_INFO, "[Aitum Multistream] stream '%s' bound to %s", name, bind_ip.c_str());
+			auto output_settings = obs_data_create();
+			obs_data_set_string(output_settings, "bind_ip", bind_ip.c_str());
+			obs_output_update(output, output_settings);
+			obs_data_release(output_settings);
 		}
 	}
-	std::string output_name = "aitum_multi_output_";
-	output_name += name;
-	auto output = obs_output_create(type, output_name.c_str(), nullptr, nullptr);
-	obs_output_set_service(output, service);
-
-	config_t *config = obs_frontend_get_profile_config();
-	if (config) {
-		obs_data_t *output_settings = obs_data_create();
-		obs_data_set_string(output_settings, "bind_ip", config_get_string(config, "Output", "BindIP"));
-		obs_data_set_string(output_settings, "ip_family", config_get_string(config, "Output", "IPFamily"));
-		obs_output_update(output, output_settings);
-		obs_data_release(output_settings);
-
-		bool useDelay = config_get_bool(config, "Output", "DelayEnable");
-		auto delaySec = (uint32_t)config_get_int(config, "Output", "DelaySec");
-		bool preserveDelay = config_get_bool(config, "Output", "DelayPreserve");
-		obs_output_set_delay(output, useDelay ? delaySec : 0, preserveDelay ? OBS_OUTPUT_DELAY_PRESERVE : 0);
+	obs_output_t *record_output = nullptr;
+	if (record_mode != RECORD_MODE_STREAM) {
+		char *record_dir = obs_frontend_get_current_record_output_path();
+		record_output = create_record_output(settings, obs_frontend_get_profile_config(), record_dir);
+		bfree(record_dir);
+		if (!record_output) {
+			// Nothing was created yet in record only mode
+			if (output) {
+				auto service = obs_output_get_service(output);
+				obs_output_release(output);
+				obs_service_release(service);
+			}
+			release_encoders();
+			return false;
+		}
+		if (!output) {
+			output = record_output;
+			record_output = nullptr;
+		}
 	}
 
+	trace_record("StartOutput.outputs", phase, os_gettime_ns());
+
 	signal_handler_t *signal = obs_output_get_signal_handler(output);
 	signal_handler_disconnect(signal, "start", stream_output_start, this);
 	signal_handler_disconnect(signal, "stop", stream_output_stop, this);
 	signal_handler_connect(signal, "start", stream_output_start, this);
 	signal_handler_connect(signal, "stop", stream_output_stop, this);
 
-	//for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
-	//auto venc = obs_output_get_video_encoder2(main_output, 0);
-	//for (size_t i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
-	//obs_output_get_audio_encoder(main_output, 0);
+	// Extra renditions and audio tracks go out over the same connection
+	std::vector<obs_encoder_t *> extra_video_encoders;
+	std::vector<obs_encoder_t *> extra_audio_encoders;
+	auto video_indexes = advanced && !custom_video_encoder ? obs_data_get_int(settings, "video_encoder_indexes") : 0;
+	if (video_indexes) {
+		auto main_output = obs_frontend_get_streaming_output();
+		auto vei = obs_data_get_int(settings, "video_encoder_index");
+		for (long long i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+			if (i == vei || !(video_indexes & (1LL << i)))
+				continue;
+			auto extra = obs_output_get_video_encoder2(main_output, (size_t)i);
+			if (extra)
+				extra_video_encoders.push_back(extra);
+			else
+				blog(LOG_WARNING, "[Aitum Multistream] video encoder index %d not found for stream '%s'",
+				     (int)i + 1, name);
+		}
+		obs_output_release(main_output);
+	}
+	auto audio_indexes = advanced ? obs_data_get_int(settings, "audio_encoder_indexes") : 0;
+	if (audio_indexes) {
+		auto main_output = obs_frontend_get_streaming_output();
+		for (long long i = 0; i < MAX_OUTPUT_AUDIO_ENCODERS; i++) {
+			if (!(audio_indexes & (1LL << i)))
+				continue;
+			auto extra = obs_output_get_audio_encoder(main_output, (size_t)i);
+			if (!extra)
+				blog(LOG_WARNING, "[Aitum Multistream] audio encoder index %d not found for stream '%s'",
+				     (int)i + 1, name);
+			else if (extra != aenc)
+				extra_audio_encoders.push_back(extra);
+		}
+		obs_output_release(main_output);
+	}
 
-	obs_output_set_video_encoder(output, venc);
-	obs_output_set_audio_encoder(output, aenc, 0);
+	set_output_encoders(output, venc, aenc, extra_video_encoders, extra_audio_encoders);
 
-	obs_output_start(output);
+	phase = os_gettime_ns();
+	const bool started = obs_output_start(output);
+	trace_record("StartOutput.start", phase, os_gettime_ns());
+	if (!started) {
+		auto last_error = obs_output_get_last_error(output);
+		std::string error = last_error && *last_error ? last_error : obs_module_text("OutputStartFailed");
+		blog(LOG_WARNING, "[Aitum Multistream] failed to start stream '%s': %s", name, error.c_str());
+		SetPreflightBadge(rowName, false, {PREFLIGHT_ERROR, error});
+		signal_handler_disconnect(signal, "start", stream_output_start, this);
+		signal_handler_disconnect(signal, "stop", stream_output_stop, this);
+		auto service = obs_output_get_service(output);
+		obs_output_release(output);
+		obs_service_release(service);
+		obs_output_release(record_output);
+		release_encoders();
+		return false;
+	}
 
-	outputs.push_back({obs_data_get_string(settings, "name"), output, streamButton});
+	if (record_output) {
+		// Same encoder handles as the stream, so the recording costs no extra encoding
+		set_output_encoders(record_output, venc, aenc, extra_video_encoders, extra_audio_encoders);
+		signal_handler_connect(obs_output_get_signal_handler(record_output), "stop", record_output_stop, this);
+		if (obs_output_start(record_output)) {
+			recordOutputs[name] = record_output;
+		} else {
+			blog(LOG_WARNING, "[Aitum Multistream] failed to start recording for stream '%s'", name);
+			signal_handler_disconnect(obs_output_get_signal_handler(record_output), "stop", record_output_stop, this);
+			obs_output_release(record_output);
+		}
+	}
+
+	if (custom_video_encoder && obs_data_get_bool(settings, "abr")) {
+		if (AbrController::Supported(obs_encoder_get_id(venc))) {
+			abrControllers[name] = new AbrController(output, venc, settings);
+		} else {
+			blog(LOG_WARNING, "[Aitum Multistream] adaptive bitrate not supported by encoder '%s' for stream '%s'",
+			     obs_encoder_get_id(venc), name);
+		}
+	}
+
+	outputs.push_back({obs_data_get_string(settings, "name"), output});
+	bandwidthBudget.Reserve(estimate);
 
 	return true;
 }
 
 void MultistreamDock::stream_output_start(void *data, calldata_t *calldata)
 {
+	TRACE_SCOPE("stream_output_start");
 	auto md = (MultistreamDock *)data;
 	auto output = (obs_output_t *)calldata_ptr(calldata, "output");
-	for (auto it = md->outputs.begin(); it != md->outputs.end(); it++) {
-		if (std::get<obs_output_t *>(*it) != output)
-			continue;
-		auto button = std::get<QPushButton *>(*it);
-		if (!button->isChecked()) {
-			QMetaObject::invokeMethod(
-				button,
-				[button, md] {
-					button->setChecked(true);
-					md->outputButtonStyle(button);
-				},
-				Qt::QueuedConnection);
-		}
-	}
+	// outputs belongs to the UI thread, the signal comes from the output's own thread
+	QMetaObject::invokeMethod(
+		md,
+		[md, output] {
+			for (auto it = md->outputs.begin(); it != md->outputs.end(); it++) {
+				if (std::get<obs_output_t *>(*it) != output)
+					continue;
+				md->liveJournal.Record(std::get<std::string>(*it), false, true);
+				md->SetOutputChecked(QString::fromUtf8(std::get<std::string>(*it).c_str()), false, true);
+			}
+		},
+		Qt::QueuedConnection);
 }
 
 void MultistreamDock::stream_output_stop(void *data, calldata_t *calldata)
 {
+	TRACE_SCOPE("stream_output_stop");
+	auto md = (MultistreamDock *)data;
+	auto output = (obs_output_t *)calldata_ptr(calldata, "output");
+	// Several stop threads can signal at once, only the UI thread touches outputs
+	QMetaObject::invokeMethod(
+		md,
+		[md, output] {
+			for (auto it = md->outputs.begin(); it != md->outputs.end(); it++) {
+				if (std::get<obs_output_t *>(*it) != output)
+					continue;
+				md->liveJournal.Record(std::get<std::string>(*it), false, false);
+				md->SetOutputChecked(QString::fromUtf8(std::get<std::string>(*it).c_str()), false, false);
+				md->outputs.erase(it);
+				if (!md->exiting) {
+					md->RemoveAbrController(output);
+					obs_output_release(output);
+				}
+				break;
+			}
+		},
+		Qt::QueuedConnection);
+	//const char *last_error = (const char *)calldata_ptr(calldata, "last_error");
+}
+
+void MultistreamDock::record_output_stop(void *data, calldata_t *calldata)
+{
+	TRACE_SCOPE("record_output_stop");
 	auto md = (MultistreamDock *)data;
 	auto output = (obs_output_t *)calldata_ptr(calldata, "output");
-	for (auto it = md->outputs.begin(); it != md->outputs.end(); it++) {
-		if (std::get<obs_output_t *>(*it) != output)
+	if (md->exiting)
+		return;
+	QMetaObject::invokeMethod(md, [md, output] { md->RemoveRecordOutput(output); }, Qt::QueuedConnection);
+}
+
+void MultistreamDock::RemoveRecordOutput(obs_output_t *output)
+{
+	for (auto it = recordOutputs.begin(); it != recordOutputs.end(); it++) {
+		if (it->second != output)
 			continue;
-		auto button = std::get<QPushButton *>(*it);
-		if (button->isChecked()) {
-			QMetaObject::invokeMethod(
-				button,
-				[button, md] {
-					button->setChecked(false);
-					md->outputButtonStyle(button);
-				},
-				Qt::QueuedConnection);
-		}
-		if (!md->exiting)
-			QMetaObject::invokeMethod(button, [output] { obs_output_release(output); }, Qt::QueuedConnection);
-		md->outputs.erase(it);
+		signal_handler_disconnect(obs_output_get_signal_handler(output), "stop", record_output_stop, this);
+		recordOutputs.erase(it);
+		obs_output_release(output);
+		break;
+	}
+}
+
+void MultistreamDock::RemoveAbrController(obs_output_t *output)
+{
+	for (auto it = abrControllers.begin(); it != abrControllers.end(); it++) {
+		if (it->second->GetOutput() != output)
+			continue;
+		delete it->second;
+		abrControllers.erase(it);
 		break;
 	}
-	//const char *last_error = (const char *)calldata_ptr(calldata, "last_error");
 }
 
 void MultistreamDock::ApiInfo(QString info)
@@ -1172,8 +1996,21 @@ void MultistreamDock::ApiInfo(QString info)
 	obs_data_release(data_obj);
 }
 
+static std::string settings_array_json(obs_data_array_t *array)
+{
+	std::string json;
+	for (size_t i = 0; i < obs_data_array_count(array); i++) {
+		auto settings = obs_data_array_item(array, i);
+		json += obs_data_get_json(settings);
+		json += '\n';
+		obs_data_release(settings);
+	}
+	return json;
+}
+
 void MultistreamDock::LoadVerticalOutputs(bool firstLoad)
 {
+	TRACE_SCOPE("LoadVerticalOutputs");
 	auto ph = obs_get_proc_handler();
 	struct calldata cd;
 	calldata_init(&cd);
@@ -1188,22 +2025,225 @@ void MultistreamDock::LoadVerticalOutputs(bool firstLoad)
 	if (vertical_outputs)
 		obs_data_array_release(vertical_outputs);
 	vertical_outputs = (obs_data_array_t *)calldata_ptr(&cd, "outputs");
+	verticalSettingsJson = settings_array_json(vertical_outputs);
+
+	calldata_free(&cd);
+	LoadVerticalOutputRows();
+}
 
+// The vertical plugin has no signal for changed settings, they are fetched again and the rows only rebuilt when they differ
+void MultistreamDock::RefreshVerticalOutputs()
+{
+	struct calldata cd;
+	calldata_init(&cd);
+	if (!proc_handler_call(obs_get_proc_handler(), "aitum_vertical_get_stream_settings", &cd)) {
+		calldata_free(&cd);
+		return;
+	}
+	auto outputs2 = (obs_data_array_t *)calldata_ptr(&cd, "outputs");
 	calldata_free(&cd);
-	int idx = 0;
-	while (auto item = verticalCanvasOutputLayout->itemAt(idx)) {
-		auto streamGroup = item->widget();
-		verticalCanvasOutputLayout->removeWidget(streamGroup);
-		RemoveWidget(streamGroup);
-	}
-
-	obs_data_array_enum(
-		vertical_outputs,
-		[](obs_data_t *data2, void *param) {
-			auto d = (MultistreamDock *)param;
-			d->LoadOutput(data2, true);
+	auto json = settings_array_json(outputs2);
+	if (json == verticalSettingsJson) {
+		obs_data_array_release(outputs2);
+		return;
+	}
+	blog(LOG_INFO, "[Aitum Multistream] vertical outputs changed");
+	obs_data_array_release(vertical_outputs);
+	vertical_outputs = outputs2;
+	verticalSettingsJson = json;
+	LoadVerticalOutputRows();
+}
+
+void MultistreamDock::LoadVerticalOutputRows()
+{
+	TRACE_SCOPE("LoadVerticalOutputRows");
+	ReleaseVerticalOutputs();
+	// Drop the warning shown while the vertical plugin was not there
+	for (int i = verticalCanvasOutputLayout->count() - 1; i >= 0; i--) {
+		auto widget = verticalCanvasOutputLayout->itemAt(i)->widget();
+		if (widget && widget != verticalList) {
+			verticalCanvasOutputLayout->removeWidget(widget);
+			RemoveWidget(widget);
+		}
+	}
+	SyncOutputRows(vertical_outputs, true);
+	ResolveVerticalOutputs();
+	if (!live)
+		return;
+	LoadHotkeys();
+	LoadSchedules();
+}
+
+// Returns a new reference. Resolved outputs are kept as weak references with their start and stop signals connected.
+obs_output_t *MultistreamDock::ResolveVerticalOutput(const std::string &name)
+{
+	auto it = verticalOutputs.find(name);
+	if (it != verticalOutputs.end()) {
+		auto output = obs_weak_output_get_output(it->second);
+		if (output)
+			return output;
+		// The vertical plugin destroyed it, its signals went with it
+		obs_weak_output_release(it->second);
+		verticalOutputs.erase(it);
+	}
+	obs_output_t *output = nullptr;
+	struct calldata cd;
+	calldata_init(&cd);
+	calldata_set_string(&cd, "name", name.c_str());
+	if (proc_handler_call(obs_get_proc_handler(), "aitum_vertical_get_stream_output", &cd))
+		output = (obs_output_t *)calldata_ptr(&cd, "output");
+	calldata_free(&cd);
+	if (!output)
+		return nullptr;
+	auto signal = obs_output_get_signal_handler(output);
+	signal_handler_connect(signal, "start", vertical_output_start, this);
+	signal_handler_connect(signal, "stop", vertical_output_stop, this);
+	verticalOutputs[name] = obs_output_get_weak_output(output);
+	return output;
+}
+
+void MultistreamDock::ResolveVerticalOutputs()
+{
+	bool resolved = false;
+	for (size_t i = 0; i < obs_data_array_count(vertical_outputs); i++) {
+		auto settings = obs_data_array_item(vertical_outputs, i);
+		std::string name = obs_data_get_string(settings, "name");
+		obs_data_release(settings);
+		const bool known = verticalOutputs.find(name) != verticalOutputs.end();
+		auto output = ResolveVerticalOutput(name);
+		resolved = resolved || (output && !known);
+		obs_output_release(output);
+	}
+	if (resolved)
+		UpdateVerticalButtons();
+}
+
+void MultistreamDock::ReleaseVerticalOutputs()
+{
+	for (auto it = verticalOutputs.begin(); it != verticalOutputs.end(); it++) {
+		auto output = obs_weak_output_get_output(it->second);
+		if (output) {
+			auto signal = obs_output_get_signal_handler(output);
+			signal_handler_disconnect(signal, "start", vertical_output_start, this);
+			signal_handler_disconnect(signal, "stop", vertical_output_stop, this);
+			obs_output_release(output);
+		}
+		obs_weak_output_release(it->second);
+	}
+	verticalOutputs.clear();
+}
+
+void MultistreamDock::UpdateVerticalButtons()
+{
+	for (int i = 0; i < verticalRows->rowCount(); i++) {
+		auto it = verticalOutputs.find(verticalRows->Row(i).name.toStdString());
+		auto output = it == verticalOutputs.end() ? nullptr : obs_weak_output_get_output(it->second);
+		const bool active = obs_output_active(output);
+		obs_output_release(output);
+		verticalRows->SetChecked(i, active);
+	}
+}
+
+void MultistreamDock::vertical_output_signal(void *data, calldata_t *calldata, bool live)
+{
+	auto md = (MultistreamDock *)data;
+	auto output = (obs_output_t *)calldata_ptr(calldata, "output");
+	// Only compared with the resolved outputs, never used, it can be gone by the time the UI thread runs this
+	QMetaObject::invokeMethod(
+		md,
+		[md, output, live] {
+			for (auto it = md->verticalOutputs.begin(); it != md->verticalOutputs.end(); it++) {
+				if (obs_weak_output_references_output(it->second, output))
+					md->liveJournal.Record(it->first, true, live);
+			}
+			md->UpdateVerticalButtons();
 		},
-		this);
+		Qt::QueuedConnection);
+}
+
+void MultistreamDock::vertical_output_start(void *data, calldata_t *calldata)
+{
+	vertical_output_signal(data, calldata, true);
+}
+
+void MultistreamDock::vertical_output_stop(void *data, calldata_t *calldata)
+{
+	vertical_output_signal(data, calldata, false);
+}
+
+int MultistreamDock::FindOutputRow(const QString &name, bool vertical)
+{
+	return OutputRows(vertical)->Find(name);
+}
+
+void MultistreamDock::SetPreflightBadge(const QString &name, bool vertical, const preflight_result &result)
+{
+	auto rows = OutputRows(vertical);
+	rows->SetBadge(rows->Find(name), result);
+}
+
+void MultistreamDock::RunPreflight(bool probe, const std::string &only)
+{
+	if (preflightProbe) {
+		preflightProbe->Abort();
+		retiredPreflightProbes.push_back(preflightProbe);
+		preflightProbe = nullptr;
+	}
+	for (auto it = retiredPreflightProbes.begin(); it != retiredPreflightProbes.end();) {
+		if ((*it)->Finished()) {
+			delete *it;
+			it = retiredPreflightProbes.erase(it);
+		} else {
+			it++;
+		}
+	}
+
+	std::vector<std::pair<obs_data_t *, bool>> destinations;
+	auto main_outputs = obs_data_get_array(current_config, "outputs");
+	for (size_t i = 0; i < obs_data_array_count(main_outputs); i++)
+		destinations.emplace_back(obs_data_array_item(main_outputs, i), false);
+	obs_data_array_release(main_outputs);
+	for (size_t i = 0; i < obs_data_array_count(vertical_outputs); i++)
+		destinations.emplace_back(obs_data_array_item(vertical_outputs, i), true);
+
+	if (probe) {
+		preflightProbe = new PreflightProbe([this](const std::string &key, const preflight_result &result) {
+			QMetaObject::invokeMethod(
+				this,
+				[this, key, result] {
+					auto rows = OutputRows(key[0] == 'v');
+					auto row = rows->Find(QString::fromUtf8(key.c_str() + 1));
+					if (row < 0)
+						return;
+					// A warning from the configuration check stays unless the probe failed
+					if (result.status == PREFLIGHT_OK && rows->Row(row).badge.status != PREFLIGHT_OK)
+						return;
+					rows->SetBadge(row, result);
+				},
+				Qt::QueuedConnection);
+		});
+	}
+	for (auto &destination : destinations) {
+		auto settings = destination.first;
+		const bool vertical = destination.second;
+		if (!only.empty() && only != std::string(vertical ? "v" : "m") + obs_data_get_string(settings, "name")) {
+			obs_data_release(settings);
+			continue;
+		}
+		auto name = QString::fromUtf8(obs_data_get_string(settings, "name"));
+		auto result = preflight_validate(settings, vertical);
+		SetPreflightBadge(name, vertical, result);
+		if (preflightProbe && result.status != PREFLIGHT_ERROR &&
+		    (vertical || obs_data_get_int(settings, "record_mode") != RECORD_MODE_RECORD)) {
+			auto server = obs_data_get_string(settings, "stream_server");
+			if (!server || !*server)
+				server = obs_data_get_string(settings, "server");
+			preflightProbe->Add(std::string(vertical ? "v" : "m") + obs_data_get_string(settings, "name"), server);
+		}
+		obs_data_release(settings);
+	}
+	if (preflightProbe)
+		preflightProbe->Start();
 }
 
 void MultistreamDock::storeMainStreamEncoders()
@@ -1,18 +1,39 @@
 #pragma once
 
+#include "bandwidth-budget.hpp"
 #include "config-dialog.hpp"
+#include "live-journal.hpp"
+#include "output-list-model.hpp"
+#include "output-scheduler.hpp"
+#include "output-lifecycle.hpp"
+#include "preflight.hpp"
+#include "rendition-groups.hpp"
+#include "stream-output.hpp"
+#include "transport.hpp"
 #include <obs.h>
 #include <obs-frontend-api.h>
+#include <QComboBox>
 #include <QFrame>
+#include <QLineEdit>
+#include <QListView>
 #include <QPushButton>
 #include <QString>
 #include <QTimer>
 #include <QVBoxLayout>
+#include <map>
 
 class OBSBasicSettings;
+class AbrController;
+struct output_hotkey;
+
+enum upload_budget_mode {
+	UPLOAD_BUDGET_WARN = 0,
+	UPLOAD_BUDGET_REFUSE = 1,
+};
 
 class MultistreamDock : public QFrame {
 	Q_OBJECT
+	friend class UiBenchmark;
 
 private:
 	OBSBasicSettings *configDialog = nullptr;
@@ -24,6 +45,16 @@ private:
 	QVBoxLayout *mainCanvasOutputLayout = nullptr;
 	QVBoxLayout *verticalCanvasLayout = nullptr;
 	QVBoxLayout *verticalCanvasOutputLayout = nullptr;
+	OutputListModel *mainRows = nullptr;
+	OutputListModel *verticalRows = nullptr;
+	OutputFilterModel *mainFilter = nullptr;
+	OutputFilterModel *verticalFilter = nullptr;
+	QListView *mainList = nullptr;
+	QListView *verticalList = nullptr;
+	QWidget *outputFilterRow = nullptr;
+	QLineEdit *outputFilterText = nullptr;
+	QComboBox *outputFilterPlatform = nullptr;
+	QComboBox *outputFilterState = nullptr;
 	QPushButton *mainStreamButton = nullptr;
 	QPushButton *configButton = nullptr;
 	QLabel *mainPlatformIconLabel = nullptr;
@@ -33,19 +64,87 @@ private:
 	time_t partnerBlockTime = 0;
 
 	QTimer videoCheckTimer;
+	QTimer followMainTimer;
+	std::vector<std::string> followPending;
+	std::vector<std::string> followStarted;
+	LiveJournal liveJournal;
+	LiveJournal::destinations resumeOutputs;
+	OutputScheduler *scheduler = nullptr;
+	QTimer scheduleTimer;
 	video_t *mainVideo = nullptr;
 	std::vector<video_t *> oldVideo;
 
-	std::vector<std::tuple<std::string, obs_output_t *, QPushButton *>> outputs;
+	std::vector<std::tuple<std::string, obs_output_t *>> outputs;
+	std::map<std::string, obs_weak_output_t *> verticalOutputs;
+	int verticalResolveTicks = 0;
 	obs_data_array_t *vertical_outputs = nullptr;
+	std::string verticalSettingsJson;
+	std::map<std::string, AbrController *> abrControllers;
+	std::map<std::string, obs_output_t *> recordOutputs;
+	BandwidthBudget bandwidthBudget;
+	RenditionGroups renditions;
+	int budgetTicks = 0;
+	bool overBudget = false;
+	OutputLifecycle *lifecycle = nullptr;
+	PreflightProbe *preflightProbe = nullptr;
+	std::vector<PreflightProbe *> retiredPreflightProbes;
+	std::vector<output_hotkey *> hotkeys;
+	obs_data_t *hotkeyBindings = nullptr;
 	bool exiting = false;
+	// Without it the dock only shows rows, no frontend events, timers, hotkeys, schedules or preflight probes
+	bool live = true;
 
 	void LoadSettingsFile();
 	void LoadSettings();
-	void LoadOutput(obs_data_t *data, bool vertical);
+	void LoadOutput(obs_data_t *data, bool vertical, int index = -1);
+	void SyncOutputRows(obs_data_array_t *outputs2, bool vertical);
+	void UpdateOutputRow(int row, obs_data_t *output_data, bool vertical);
+	void RemoveOutputRow(int row, bool vertical);
+	void RemoveOutputRows(bool vertical);
+	void RenameOutput(const std::string &from, const std::string &to);
+	bool UpdateLiveOutput(obs_data_t *output_data);
+	void OutputButtonClicked(const QString &key, bool vertical);
+	void SetOutputChecked(const QString &name, bool vertical, bool checked);
+	void ApplyOutputFilter();
+	void FitOutputLists();
+	void ApplySettingsChanges(obs_data_t *settings);
 	void SaveSettings();
-
-	bool StartOutput(obs_data_t *settings, QPushButton *streamButton);
+	void LoadVerticalOutputRows();
+	void VideoCheckTick();
+	void QueueFollower(const std::string &name);
+	void StartFollowers();
+	void FollowMainTick();
+	void StopFollowers();
+	void ResumeLiveOutputs();
+	void StartOrQueue(const std::string &name, bool vertical);
+	obs_output_t *ResolveVerticalOutput(const std::string &name);
+	void ResolveVerticalOutputs();
+	void RefreshVerticalOutputs();
+	void ReleaseVerticalOutputs();
+	void UpdateVerticalButtons();
+	void LoadSchedules();
+	void PrepareScheduledStart(const schedule_entry &entry);
+	bool RunSchedule(const schedule_entry &entry);
+	// Only checks the destination with the probe key, 'm' or 'v' followed by the name, when one is given
+	void RunPreflight(bool probe, const std::string &only = std::string());
+	OutputListModel *OutputRows(bool vertical) { return vertical ? verticalRows : mainRows; }
+	int FindOutputRow(const QString &name, bool vertical);
+	void SetPreflightBadge(const QString &name, bool vertical, const preflight_result &result);
+	void LoadHotkeys();
+	void SaveHotkeys();
+	void UnregisterHotkeys(bool save);
+	void LoadHotkeyBindings();
+	void RegisterHotkey(const std::string &key, const char *startText, const char *stopText, const std::string &label,
+			    const std::vector<std::pair<std::string, bool>> &targets);
+	void RunHotkey(const std::vector<std::pair<std::string, bool>> &targets, bool start);
+
+	bool ConfirmStart();
+	bool StartOutput(obs_data_t *settings, bool confirm);
+	void StopOutput(const char *name);
+	obs_output_t *GetOutput(const char *name, bool vertical);
+	std::string PickBindIp(const char *server, const char *ip_family);
+	void RemoveRecordOutput(obs_output_t *output);
+	void RemoveAbrController(obs_output_t *output);
 
 	void outputButtonStyle(QPushButton *button);
 
@@ -58,14 +157,26 @@ private:
 
 	static void stream_output_stop(void *data, calldata_t *calldata);
 	static void stream_output_start(void *data, calldata_t *calldata);
+	static void record_output_stop(void *data, calldata_t *calldata);
+	static void vertical_output_signal(void *data, calldata_t *calldata, bool live);
+	static void vertical_output_start(void *data, calldata_t *calldata);
+	static void vertical_output_stop(void *data, calldata_t *calldata);
+	static void hotkey_pressed(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed);
 
 private slots:
 	void ApiInfo(QString info);
 
 public:
-	MultistreamDock(QWidget *parent = nullptr);
+	MultistreamDock(QWidget *parent = nullptr, bool live = true);
 	~MultistreamDock();
 	void LoadVerticalOutputs(bool firstLoad = true);
+	void RecoverLiveOutputs();
+
+	// External control, see plugin-api.hpp. Must be called on the UI thread.
+	obs_data_array_t *ApiListOutputs();
+	obs_data_t *ApiGetStats();
+	bool ApiStartOutput(const char *name, bool vertical, std::string &error);
+	bool ApiStopOutput(const char *name, bool vertical, std::string &error);
 };
 
 class AspectRatioPixmapLabel : public QLabel {
@@ -0,0 +1,157 @@
+#include "multistream.hpp"
+#include <obs-module.h>
+#include <QString>
+#include <algorithm>
+
+#define HOTKEY_PREFIX_START "AitumMultistream.Start."
+#define HOTKEY_PREFIX_STOP "AitumMultistream.Stop."
+
+struct output_hotkey {
+	MultistreamDock *dock;
+	std::string startName;
+	std::string stopName;
+	std::vector<std::pair<std::string, bool>> targets;
+	obs_hotkey_id start = OBS_INVALID_HOTKEY_ID;
+	obs_hotkey_id stop = OBS_INVALID_HOTKEY_ID;
+};
+
+// Comma separated group names, trimmed and without duplicates
+static std::vector<std::string> output_groups(const char *groups)
+{
+	std::vector<std::string> result;
+	for (auto &group : QString::fromUtf8(groups).split(QChar(','))) {
+		std::string name = group.trimmed().toUtf8().constData();
+		if (!name.empty() && std::find(result.begin(), result.end(), name) == result.end())
+			result.push_back(name);
+	}
+	return result;
+}
+
+static void save_hotkey_binding(obs_data_t *bindings, obs_hotkey_id id, const std::string &name)
+{
+	auto array = obs_hotkey_save(id);
+	if (obs_data_array_count(array))
+		obs_data_set_array(bindings, name.c_str(), array);
+	else
+		obs_data_erase(bindings, name.c_str());
+	obs_data_array_release(array);
+}
+
+static void load_hotkey_binding(obs_data_t *bindings, obs_hotkey_id id, const std::string &name)
+{
+	auto array = obs_data_get_array(bindings, name.c_str());
+	if (array)
+		obs_hotkey_load(id, array);
+	obs_data_array_release(array);
+}
+
+// Runs on the hotkey thread. The targets of a registered hotkey never change, so the callback only copies them into a
+// queued call to the UI thread without taking any lock of the dock or touching widgets.
+void MultistreamDock::hotkey_pressed(void *data, obs_hotkey_id id, obs_hotkey_t *hotkey, bool pressed)
+{
+	UNUSED_PARAMETER(hotkey);
+	if (!pressed)
+		return;
+	auto oh = (output_hotkey *)data;
+	auto md = oh->dock;
+	auto targets = oh->targets;
+	const bool start = id == oh->start;
+	QMetaObject::invokeMethod(md, [md, targets, start] { md->RunHotkey(targets, start); }, Qt::QueuedConnection);
+}
+
+// One pass on the UI thread for the whole group, the same path as a batched API start
+void MultistreamDock::RunHotkey(const std::vector<std::pair<std::string, bool>> &targets, bool start)
+{
+	for (auto &target : targets) {
+		std::string error;
+		bool success = start ? ApiStartOutput(target.first.c_str(), target.second, error)
+				     : ApiStopOutput(target.first.c_str(), target.second, error);
+		if (!success)
+			blog(LOG_WARNING, "[Aitum Multistream] hotkey failed to %s '%s': %s", start ? "start" : "stop",
+			     target.first.c_str(), error.c_str());
+	}
+}
+
+void MultistreamDock::RegisterHotkey(const std::string &key, const char *startText, const char *stopText, const std::string &label,
+				     const std::vector<std::pair<std::string, bool>> &targets)
+{
+	auto oh = new output_hotkey;
+	oh->dock = this;
+	oh->startName = HOTKEY_PREFIX_START + key;
+	oh->stopName = HOTKEY_PREFIX_STOP + key;
+	oh->targets = targets;
+	auto startDescription = QString::fromUtf8(obs_module_text(startText)).arg(QString::fromUtf8(label.c_str())).toUtf8();
+	auto stopDescription = QString::fromUtf8(obs_module_text(stopText)).arg(QString::fromUtf8(label.c_str())).toUtf8();
+	oh->start = obs_hotkey_register_frontend(oh->startName.c_str(), startDescription.constData(), hotkey_pressed, oh);
+	oh->stop = obs_hotkey_register_frontend(oh->stopName.c_str(), stopDescription.constData(), hotkey_pressed, oh);
+	load_hotkey_binding(hotkeyBindings, oh->start, oh->startName);
+	load_hotkey_binding(hotkeyBindings, oh->stop, oh->stopName);
+	hotkeys.push_back(oh);
+}
+
+void MultistreamDock::LoadHotkeys()
+{
+	UnregisterHotkeys(true);
+	if (!hotkeyBindings)
+		hotkeyBindings = obs_data_create();
+
+	std::map<std::string, std::vector<std::pair<std::string, bool>>> groups;
+	auto add = [this, &groups](obs_data_t *settings, bool vertical) {
+		std::string name = obs_data_get_string(settings, "name");
+		if (name.empty())
+			return;
+		RegisterHotkey((vertical ? "vertical." : "main.") + name,
+			       vertical ? "HotkeyStartVerticalOutput" : "HotkeyStartOutput",
+			       vertical ? "HotkeyStopVerticalOutput" : "HotkeyStopOutput", name, {{name, vertical}});
+		for (auto &group : output_groups(obs_data_get_string(settings, "groups")))
+			groups[group].emplace_back(name, vertical);
+	};
+	auto main_outputs = current_config ? obs_data_get_array(current_config, "outputs") : nullptr;
+	size_t count = obs_data_array_count(main_outputs);
+	for (size_t i = 0; i < count; i++) {
+		auto settings = obs_data_array_item(main_outputs, i);
+		add(settings, false);
+		obs_data_release(settings);
+	}
+	obs_data_array_release(main_outputs);
+	count = obs_data_array_count(vertical_outputs);
+	for (size_t i = 0; i < count; i++) {
+		auto settings = obs_data_array_item(vertical_outputs, i);
+		add(settings, true);
+		obs_data_release(settings);
+	}
+	for (auto &group : groups)
+		RegisterHotkey("group." + group.first, "HotkeyStartGroup", "HotkeyStopGroup", group.first, group.second);
+}
+
+void MultistreamDock::SaveHotkeys()
+{
+	if (!hotkeyBindings)
+		return;
+	for (auto oh : hotkeys) {
+		save_hotkey_binding(hotkeyBindings, oh->start, oh->startName);
+		save_hotkey_binding(hotkeyBindings, oh->stop, oh->stopName);
+	}
+}
+
+void MultistreamDock::UnregisterHotkeys(bool save)
+{
+	if (save)
+		SaveHotkeys();
+	for (auto oh : hotkeys) {
+		obs_hotkey_unregister(oh->start);
+		obs_hotkey_unregister(oh->stop);
+		delete oh;
+	}
+	hotkeys.clear();
+}
+
+void MultistreamDock::LoadHotkeyBindings()
+{
+	// Bindings of the previous profile were saved with its settings
+	UnregisterHotkeys(false);
+	obs_data_release(hotkeyBindings);
+	hotkeyBindings = current_config ? obs_data_get_obj(current_config, "hotkeys") : nullptr;
+	if (!hotkeyBindings)
+		hotkeyBindings = obs_data_create();
+}
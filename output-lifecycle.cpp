@@ -0,0 +1,152 @@
+#include "output-lifecycle.hpp"
+#include <obs-module.h>
+#include <util/platform.h>
+#include <algorithm>
+#include <chrono>
+
+OutputLifecycle::OutputLifecycle() : state(std::make_shared<stop_state>()) {}
+
+OutputLifecycle::~OutputLifecycle()
+{
+	Retire(state);
+}
+
+bool OutputLifecycle::AllDone(const std::list<stop_thread> &stops)
+{
+	return std::all_of(stops.begin(), stops.end(), [](const stop_thread &stop) { return stop.done; });
+}
+
+// Joins the stop threads that are done. The others are detached, they keep their output reference and run on until
+// their stop returns. The plugin library gets an extra reference first so unloading the module does not unmap the code
+// they are running. libobs task queues are no option, the dock can be destroyed from obs_module_unload after libobs has
+// torn them down.
+void OutputLifecycle::Retire(const std::shared_ptr<stop_state> &state)
+{
+	std::list<stop_thread> finished;
+	size_t running = 0;
+	{
+		std::lock_guard<std::mutex> lock(state->mutex);
+		for (auto it = state->stops.begin(); it != state->stops.end();) {
+			auto next = std::next(it);
+			if (it->done) {
+				finished.splice(finished.end(), state->stops, it);
+			} else {
+				it->thread.detach();
+				running++;
+			}
+			it = next;
+		}
+	}
+	for (auto &stop : finished)
+		stop.thread.join();
+	if (!running)
+		return;
+
+	static bool pinned = false;
+	if (!pinned) {
+		auto module = obs_current_module();
+		pinned = module && os_dlopen(obs_get_module_binary_path(module));
+	}
+	blog(LOG_WARNING, "[Aitum Multistream] left %d output stop(s) running%s", (int)running,
+	     pinned ? "" : ", failed to keep the plugin loaded for them");
+}
+
+void OutputLifecycle::JoinFinished()
+{
+	std::list<stop_thread> finished;
+	{
+		std::lock_guard<std::mutex> lock(state->mutex);
+		for (auto it = state->stops.begin(); it != state->stops.end();) {
+			auto next = std::next(it);
+			if (it->done)
+				finished.splice(finished.end(), state->stops, it);
+			it = next;
+		}
+	}
+	for (auto &stop : finished)
+		stop.thread.join();
+}
+
+void OutputLifecycle::Stop(obs_output_t *output)
+{
+	JoinFinished();
+	std::lock_guard<std::mutex> lock(state->mutex);
+	for (auto &stop : state->stops) {
+		if (stop.output == output && !stop.done)
+			return;
+	}
+	output = obs_output_get_ref(output);
+	if (!output)
+		return;
+	state->stops.push_back({output, obs_output_get_name(output), std::thread(), false});
+	auto stop = std::prev(state->stops.end());
+	// The thread waits for the lock until its handle is stored
+	stop->thread = std::thread([state = state, stop, output] {
+		os_set_thread_name("aitum-multistream-stop");
+		uint32_t lagged = obs_get_lagged_frames();
+		uint64_t start = os_gettime_ns();
+		obs_output_stop(output);
+		double ms = (double)(os_gettime_ns() - start) / 1000000.0;
+		uint32_t lagged_during_stop = obs_get_lagged_frames() - lagged;
+		blog(lagged_during_stop ? LOG_WARNING : LOG_INFO,
+		     "[Aitum Multistream] stopped output '%s' in %.1fms, %u lagged frame(s) during stop", stop->name.c_str(), ms,
+		     lagged_during_stop);
+		obs_output_release(output);
+
+		std::lock_guard<std::mutex> lock(state->mutex);
+		stop->done = true;
+		state->idle.notify_all();
+	});
+}
+
+static std::chrono::nanoseconds time_left(uint64_t deadline_ns)
+{
+	uint64_t now = os_gettime_ns();
+	return std::chrono::nanoseconds(deadline_ns > now ? deadline_ns - now : 0);
+}
+
+bool OutputLifecycle::WaitIdle(uint64_t deadline_ns)
+{
+	std::unique_lock<std::mutex> lock(state->mutex);
+	return state->idle.wait_for(lock, time_left(deadline_ns), [this] { return AllDone(state->stops); });
+}
+
+void OutputLifecycle::ForceStopAll(const std::vector<obs_output_t *> &outputs, bool release, uint64_t deadline_ns)
+{
+	auto state = std::make_shared<stop_state>();
+	uint64_t start = os_gettime_ns();
+	{
+		std::lock_guard<std::mutex> lock(state->mutex);
+		for (auto output : outputs) {
+			state->stops.push_back({output, obs_output_get_name(output), std::thread(), false});
+			auto stop = std::prev(state->stops.end());
+			stop->thread = std::thread([state, stop, output, release] {
+				auto service = obs_output_get_service(output);
+				if (obs_output_active(output))
+					obs_output_force_stop(output);
+				if (release)
+					obs_output_release(output);
+				obs_service_release(service);
+
+				std::lock_guard<std::mutex> lock(state->mutex);
+				stop->done = true;
+				state->idle.notify_all();
+			});
+		}
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(state->mutex);
+		if (state->idle.wait_for(lock, time_left(deadline_ns), [&state] { return AllDone(state->stops); })) {
+			blog(LOG_INFO, "[Aitum Multistream] stopped %d output(s) in %.1fms", (int)outputs.size(),
+			     (double)(os_gettime_ns() - start) / 1000000.0);
+		} else {
+			for (auto &stop : state->stops) {
+				if (!stop.done)
+					blog(LOG_WARNING, "[Aitum Multistream] output '%s' still stopping at the shutdown deadline",
+					     stop.name.c_str());
+			}
+		}
+	}
+	Retire(state);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <obs.h>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs output teardown off the graphics and UI thread. Every stop gets a thread of its own, so a stop stuck on a dead
+// socket never holds up the stops of other outputs. The stop threads that are done are joined when the lifecycle is
+// destroyed, the others are left running with the plugin kept loaded, see Retire.
+class OutputLifecycle {
+public:
+	OutputLifecycle();
+	~OutputLifecycle();
+
+	void Stop(obs_output_t *output);
+	bool WaitIdle(uint64_t deadline_ns);
+
+	// Force stops all outputs at once, each on its own thread, and waits for them until the deadline. Stops still
+	// running then are logged and left running.
+	static void ForceStopAll(const std::vector<obs_output_t *> &outputs, bool release, uint64_t deadline_ns);
+
+private:
+	struct stop_thread {
+		obs_output_t *output;
+		std::string name;
+		std::thread thread;
+		bool done = false;
+	};
+	// Shared with the stop threads, which can outlive the lifecycle
+	struct stop_state {
+		std::mutex mutex;
+		std::condition_variable idle;
+		std::list<stop_thread> stops;
+	};
+	std::shared_ptr<stop_state> state;
+
+	static bool AllDone(const std::list<stop_thread> &stops);
+	void JoinFinished();
+	static void Retire(const std::shared_ptr<stop_state> &state);
+};
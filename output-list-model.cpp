@@ -0,0 +1,243 @@
+#include "output-list-model.hpp"
+#include <obs-module.h>
+#include <QAbstractItemView>
+#include <QHelpEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QToolTip>
+
+OutputListModel::OutputListModel(QObject *parent) : QAbstractListModel(parent) {}
+
+int OutputListModel::rowCount(const QModelIndex &parent) const
+{
+	return parent.isValid() ? 0 : (int)rows.size();
+}
+
+QVariant OutputListModel::data(const QModelIndex &index, int role) const
+{
+	if (!index.isValid() || index.row() >= (int)rows.size())
+		return QVariant();
+	auto &row = rows[index.row()];
+	switch (role) {
+	case Qt::DisplayRole:
+		return row.name;
+	case Qt::DecorationRole:
+		return row.icon;
+	case Qt::ToolTipRole:
+		return QString::fromUtf8(row.badge.message.c_str());
+	case KeyRole:
+		return QString::fromUtf8(row.key.c_str());
+	case PlatformRole:
+		return row.platform;
+	case CheckedRole:
+		return row.checked;
+	case BadgeRole:
+		return (int)row.badge.status;
+	default:
+		return QVariant();
+	}
+}
+
+int OutputListModel::Find(const QString &name) const
+{
+	for (size_t i = 0; i < rows.size(); i++) {
+		if (rows[i].name == name)
+			return (int)i;
+	}
+	return -1;
+}
+
+int OutputListModel::FindKey(const std::string &key) const
+{
+	for (size_t i = 0; i < rows.size(); i++) {
+		if (rows[i].key == key)
+			return (int)i;
+	}
+	return -1;
+}
+
+void OutputListModel::Insert(int row, const output_row &data)
+{
+	if (row < 0 || row > (int)rows.size())
+		row = (int)rows.size();
+	beginInsertRows(QModelIndex(), row, row);
+	rows.insert(rows.begin() + row, data);
+	endInsertRows();
+}
+
+void OutputListModel::Remove(int row)
+{
+	beginRemoveRows(QModelIndex(), row, row);
+	rows.erase(rows.begin() + row);
+	endRemoveRows();
+}
+
+// Moves the row at from so it ends up at to, to is before from
+void OutputListModel::Move(int from, int to)
+{
+	if (from == to || !beginMoveRows(QModelIndex(), from, from, QModelIndex(), to))
+		return;
+	auto data = std::move(rows[from]);
+	rows.erase(rows.begin() + from);
+	rows.insert(rows.begin() + to, std::move(data));
+	endMoveRows();
+}
+
+void OutputListModel::Update(int row, const output_row &data)
+{
+	rows[row] = data;
+	emit dataChanged(index(row), index(row));
+}
+
+void OutputListModel::SetChecked(int row, bool checked)
+{
+	if (row < 0 || rows[row].checked == checked)
+		return;
+	rows[row].checked = checked;
+	emit dataChanged(index(row), index(row), {CheckedRole});
+}
+
+void OutputListModel::SetBadge(int row, const preflight_result &badge)
+{
+	if (row < 0)
+		return;
+	rows[row].badge = badge;
+	emit dataChanged(index(row), index(row), {BadgeRole, Qt::ToolTipRole});
+}
+
+OutputFilterModel::OutputFilterModel(QObject *parent) : QSortFilterProxyModel(parent)
+{
+	// Live state and badges change all the time, rows have to come and go with them
+	setDynamicSortFilter(true);
+}
+
+void OutputFilterModel::SetFilter(const QString &text_, const QString &platform_, int state_)
+{
+	if (text == text_ && platform == platform_ && state == state_)
+		return;
+	text = text_;
+	platform = platform_;
+	state = state_;
+	invalidateFilter();
+}
+
+bool OutputFilterModel::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const
+{
+	auto index = sourceModel()->index(source_row, 0, source_parent);
+	if (!text.isEmpty() && !index.data(Qt::DisplayRole).toString().contains(text, Qt::CaseInsensitive))
+		return false;
+	if (!platform.isEmpty() && index.data(OutputListModel::PlatformRole).toString() != platform)
+		return false;
+	const bool checked = index.data(OutputListModel::CheckedRole).toBool();
+	const int badge = index.data(OutputListModel::BadgeRole).toInt();
+	switch (state) {
+	case OUTPUT_FILTER_LIVE:
+		return checked;
+	case OUTPUT_FILTER_IDLE:
+		return !checked;
+	case OUTPUT_FILTER_PROBLEM:
+		return badge == PREFLIGHT_WARNING || badge == PREFLIGHT_ERROR;
+	default:
+		return true;
+	}
+}
+
+// Same spacing, icon and button sizes as the rows that were widgets
+static QRect row_rect(const QRect &rect)
+{
+	return rect.adjusted(0, 2, 0, -2);
+}
+
+static QRect icon_rect(const QRect &row)
+{
+	return QRect(row.left() + 6, row.top() + (row.height() - 36) / 2, 36, 36);
+}
+
+static QRect button_rect(const QRect &row)
+{
+	return QRect(row.right() - 56, row.top() + (row.height() - 30) / 2, 50, 30);
+}
+
+static QRect badge_rect(const QRect &row)
+{
+	auto button = button_rect(row);
+	return QRect(button.left() - 18, row.top() + (row.height() - 10) / 2, 10, 10);
+}
+
+static QColor badge_color(int status)
+{
+	if (status == PREFLIGHT_OK)
+		return QColor(0, 210, 153);
+	if (status == PREFLIGHT_WARNING)
+		return QColor(192, 128, 0);
+	if (status == PREFLIGHT_ERROR)
+		return QColor(210, 60, 60);
+	return QColor(128, 128, 128);
+}
+
+OutputRowDelegate::OutputRowDelegate(const QIcon &activeIcon_, const QIcon &inactiveIcon_, QObject *parent)
+	: QStyledItemDelegate(parent),
+	  activeIcon(activeIcon_),
+	  inactiveIcon(inactiveIcon_)
+{
+}
+
+void OutputRowDelegate::paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+	auto row = row_rect(option.rect);
+	const bool checked = index.data(OutputListModel::CheckedRole).toBool();
+	painter->save();
+	painter->setRenderHint(QPainter::Antialiasing);
+	painter->fillRect(row, option.palette.color(QPalette::Mid));
+
+	index.data(Qt::DecorationRole).value<QIcon>().paint(painter, icon_rect(row));
+
+	auto badge = badge_rect(row);
+	auto icon = icon_rect(row);
+	QRect name(icon.right() + 8, row.top(), badge.left() - icon.right() - 16, row.height());
+	painter->setFont(option.font);
+	painter->setPen(option.palette.color(QPalette::WindowText));
+	painter->drawText(name, Qt::AlignVCenter | Qt::AlignLeft,
+			  option.fontMetrics.elidedText(index.data(Qt::DisplayRole).toString(), Qt::ElideRight, name.width()));
+
+	painter->setPen(Qt::NoPen);
+	painter->setBrush(badge_color(index.data(OutputListModel::BadgeRole).toInt()));
+	painter->drawEllipse(badge);
+
+	auto button = button_rect(row);
+	painter->setPen(QPen(option.palette.color(QPalette::Dark), 2));
+	painter->setBrush(checked ? QColor(0, 210, 153) : option.palette.color(QPalette::Button));
+	painter->drawRoundedRect(QRectF(button).adjusted(1, 1, -1, -1), 4, 4);
+	(checked ? activeIcon : inactiveIcon).paint(painter, QRect(button.center().x() - 8, button.center().y() - 8, 16, 16));
+	painter->restore();
+}
+
+QSize OutputRowDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+	UNUSED_PARAMETER(index);
+	return QSize(option.rect.width(), OUTPUT_ROW_HEIGHT);
+}
+
+bool OutputRowDelegate::editorEvent(QEvent *event, QAbstractItemModel *model, const QStyleOptionViewItem &option,
+				    const QModelIndex &index)
+{
+	if (event->type() != QEvent::MouseButtonPress && event->type() != QEvent::MouseButtonRelease &&
+	    event->type() != QEvent::MouseButtonDblClick)
+		return QStyledItemDelegate::editorEvent(event, model, option, index);
+	auto mouse = static_cast<QMouseEvent *>(event);
+	if (mouse->button() != Qt::LeftButton || !button_rect(row_rect(option.rect)).contains(mouse->position().toPoint()))
+		return false;
+	if (event->type() == QEvent::MouseButtonRelease)
+		emit buttonClicked(index.data(OutputListModel::KeyRole).toString());
+	return true;
+}
+
+bool OutputRowDelegate::helpEvent(QHelpEvent *event, QAbstractItemView *view, const QStyleOptionViewItem &option,
+				  const QModelIndex &index)
+{
+	if (event->type() == QEvent::ToolTip && button_rect(row_rect(option.rect)).contains(event->pos())) {
+		QToolTip::showText(event->globalPos(), QString::fromUtf8(obs_module_text("Stream")), view);
+		return true;
+	}
+	return QStyledItemDelegate::helpEvent(event, view, option, index);
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "preflight.hpp"
+#include <QAbstractListModel>
+#include <QIcon>
+#include <QSortFilterProxyModel>
+#include <QStyledItemDelegate>
+#include <string>
+#include <vector>
+
+// Height of a destination row in the dock, the platform icon is 36 pixels
+#define OUTPUT_ROW_HEIGHT 48
+
+// Below this many destinations the dock does not show the filter row
+#define OUTPUT_FILTER_MIN_ROWS 8
+
+enum output_filter_state {
+	OUTPUT_FILTER_ALL = 0,
+	OUTPUT_FILTER_LIVE = 1,
+	OUTPUT_FILTER_IDLE = 2,
+	OUTPUT_FILTER_PROBLEM = 3,
+};
+
+// One destination of a canvas section in the dock
+struct output_row {
+	// Output id on the main canvas, the name on the vertical canvas where the vertical plugin owns the settings
+	std::string key;
+	QString name;
+	QString platform;
+	QIcon icon;
+	// Settings the row was last updated from, as JSON
+	QString settings;
+	// Started, or waiting to start with the main stream
+	bool checked = false;
+	preflight_result badge;
+};
+
+// The destinations of a canvas section. Rows are plain data, the delegate paints them so a hundred destinations cost a
+// hundred structs instead of a hundred widget trees.
+class OutputListModel : public QAbstractListModel {
+	Q_OBJECT
+
+public:
+	enum Role {
+		KeyRole = Qt::UserRole + 1,
+		PlatformRole,
+		CheckedRole,
+		BadgeRole,
+	};
+
+	explicit OutputListModel(QObject *parent = nullptr);
+
+	int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+	const output_row &Row(int row) const { return rows[row]; }
+	int Find(const QString &name) const;
+	int FindKey(const std::string &key) const;
+	void Insert(int row, const output_row &data);
+	void Remove(int row);
+	void Move(int from, int to);
+	void Update(int row, const output_row &data);
+	void SetChecked(int row, bool checked);
+	void SetBadge(int row, const preflight_result &badge);
+
+private:
+	std::vector<output_row> rows;
+};
+
+// Filters by a part of the name, the platform and the state
+class OutputFilterModel : public QSortFilterProxyModel {
+	Q_OBJECT
+
+public:
+	explicit OutputFilterModel(QObject *parent = nullptr);
+
+	void SetFilter(const QString &text, const QString &platform, int state);
+
+protected:
+	bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const override;
+
+private:
+	QString text;
+	QString platform;
+	int state = OUTPUT_FILTER_ALL;
+};
+
+// Paints a destination like the group boxes the dock used before: platform icon, name, preflight badge and the stream
+// button. Clicking the button area emits the key of the row.
+class OutputRowDelegate : public QStyledItemDelegate {
+	Q_OBJECT
+
+public:
+	OutputRowDelegate(const QIcon &activeIcon, const QIcon &inactiveIcon, QObject *parent = nullptr);
+
+	void paint(QPainter *painter, const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+	QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+	bool editorEvent(QEvent *event, QAbstractItemModel *model, const QStyleOptionViewItem &option,
+			 const QModelIndex &index) override;
+	bool helpEvent(QHelpEvent *event, QAbstractItemView *view, const QStyleOptionViewItem &option,
+		       const QModelIndex &index) override;
+
+signals:
+	void buttonClicked(const QString &key);
+
+private:
+	QIcon activeIcon;
+	QIcon inactiveIcon;
+};
@@ -0,0 +1,226 @@
+#include "output-scheduler.hpp"
+#include <obs-module.h>
+#include <util/dstr.h>
+#include <cstring>
+#include <sstream>
+
+#define SCHEDULE_GROUP_TIME 0
+#define SCHEDULE_GROUP_MAIN 1
+
+static const char *weekdays[] = {"sun", "mon", "tue", "wed", "thu", "fri", "sat"};
+
+// "90", "5:00" or "1:30:00"
+static bool parse_duration(const std::string &text, int64_t &seconds)
+{
+	if (text.empty())
+		return false;
+	seconds = 0;
+	int parts = 0;
+	std::stringstream stream(text);
+	std::string part;
+	while (std::getline(stream, part, ':')) {
+		if (part.empty() || part.size() > 5 || part.find_first_not_of("0123456789") != std::string::npos || ++parts > 3)
+			return false;
+		seconds = seconds * 60 + std::stoll(part);
+	}
+	return parts > 0;
+}
+
+static bool parse_item(const std::string &item, schedule_entry &entry)
+{
+	std::stringstream stream(item);
+	std::string word;
+	std::vector<std::string> words;
+	while (stream >> word)
+		words.push_back(word);
+	if (words.empty())
+		return false;
+	if (words.size() == 1 && (words[0].rfind("T+", 0) == 0 || words[0].rfind("t+", 0) == 0)) {
+		entry.trigger = SCHEDULE_AFTER_MAIN;
+		return parse_duration(words[0].substr(2), entry.seconds);
+	}
+	entry.trigger = SCHEDULE_TIME_OF_DAY;
+	entry.days = 0;
+	for (size_t i = 0; i + 1 < words.size(); i++) {
+		size_t day = 0;
+		while (day < 7 && astrcmpi(words[i].c_str(), weekdays[day]) != 0)
+			day++;
+		if (day == 7)
+			return false;
+		entry.days |= (uint8_t)(1 << day);
+	}
+	// A time of day needs at least hours and minutes
+	if (words.back().find(':') == std::string::npos || !parse_duration(words.back(), entry.seconds))
+		return false;
+	if (words.back().find(':') == words.back().rfind(':'))
+		entry.seconds *= 60;
+	return entry.seconds < 24 * 60 * 60;
+}
+
+bool schedule_parse(const char *text, const std::string &name, bool vertical, bool start, std::vector<schedule_entry> &entries)
+{
+	if (!text)
+		return true;
+	std::stringstream stream(text);
+	std::string item;
+	while (std::getline(stream, item, ';')) {
+		if (item.find_first_not_of(" \t") == std::string::npos)
+			continue;
+		schedule_entry entry;
+		entry.name = name;
+		entry.vertical = vertical;
+		entry.start = start;
+		if (!parse_item(item, entry))
+			return false;
+		entries.push_back(entry);
+	}
+	return true;
+}
+
+time_t schedule_next_time(const schedule_entry &entry, time_t now)
+{
+	struct tm today;
+#ifdef _WIN32
+	localtime_s(&today, &now);
+#else
+	localtime_r(&now, &today);
+#endif
+	// mktime normalizes the day overflow and applies the daylight saving time of the target day
+	for (int day = 0; day <= 7; day++) {
+		struct tm t = today;
+		t.tm_mday += day;
+		t.tm_hour = (int)(entry.seconds / 3600);
+		t.tm_min = (int)(entry.seconds / 60 % 60);
+		t.tm_sec = (int)(entry.seconds % 60);
+		t.tm_isdst = -1;
+		time_t when = mktime(&t);
+		if (when <= now || (entry.days && !(entry.days & (1 << t.tm_wday))))
+			continue;
+		return when;
+	}
+	return 0;
+}
+
+void TimerWheel::Reset(time_t now)
+{
+	for (auto &slot : slots)
+		slot.clear();
+	current = now;
+}
+
+void TimerWheel::Add(time_t deadline, int group, task run)
+{
+	// Overdue timers run on the next tick
+	if (deadline <= current)
+		deadline = current + 1;
+	slots[deadline % SCHEDULE_WHEEL_SLOTS].push_back({deadline, group, std::move(run)});
+}
+
+void TimerWheel::CancelGroup(int group)
+{
+	for (auto &slot : slots) {
+		for (auto it = slot.begin(); it != slot.end();) {
+			if (it->group == group)
+				it = slot.erase(it);
+			else
+				it++;
+		}
+	}
+}
+
+void TimerWheel::Advance(time_t now)
+{
+	if (now <= current && now > current - SCHEDULE_WHEEL_SLOTS)
+		return;
+	// After a sleep or a clock change every slot is due for a look
+	time_t from = now - current > SCHEDULE_WHEEL_SLOTS || now < current ? now - SCHEDULE_WHEEL_SLOTS + 1 : current + 1;
+	current = now;
+	std::vector<task> due;
+	for (time_t t = from; t <= now; t++) {
+		auto &slot = slots[t % SCHEDULE_WHEEL_SLOTS];
+		for (auto it = slot.begin(); it != slot.end();) {
+			if (it->deadline <= now) {
+				due.push_back(std::move(it->run));
+				it = slot.erase(it);
+			} else {
+				it++;
+			}
+		}
+	}
+	// Tasks can add timers, so they run after the slots are done
+	for (auto &run : due)
+		run();
+}
+
+OutputScheduler::OutputScheduler(prepare_cb prepare_, fire_cb fire_) : prepare(prepare_), fire(fire_) {}
+
+void OutputScheduler::Load(std::vector<schedule_entry> entries_, int lead_, time_t now)
+{
+	entries = std::move(entries_);
+	lead = lead_ < 0 ? 0 : lead_;
+	wheel.Reset(now);
+	for (auto &entry : entries) {
+		if (entry.trigger == SCHEDULE_TIME_OF_DAY || mainStart)
+			Arm(entry, now);
+	}
+}
+
+void OutputScheduler::MainStarted(time_t now)
+{
+	if (mainStart)
+		return;
+	mainStart = now;
+	for (auto &entry : entries) {
+		if (entry.trigger == SCHEDULE_AFTER_MAIN)
+			Arm(entry, now);
+	}
+}
+
+void OutputScheduler::MainStopped()
+{
+	mainStart = 0;
+	wheel.CancelGroup(SCHEDULE_GROUP_MAIN);
+}
+
+void OutputScheduler::Tick(time_t now)
+{
+	// A start callback that spins an event loop must not advance the wheel from inside Advance
+	if (ticking)
+		return;
+	ticking = true;
+	wheel.Advance(now);
+	ticking = false;
+}
+
+void OutputScheduler::Arm(const schedule_entry &entry, time_t now)
+{
+	time_t when;
+	int group;
+	if (entry.trigger == SCHEDULE_AFTER_MAIN) {
+		when = mainStart + (time_t)entry.seconds;
+		// Restarting the plugin mid show does not replay what already happened
+		if (when < now)
+			return;
+		group = SCHEDULE_GROUP_MAIN;
+	} else {
+		when = schedule_next_time(entry, now);
+		if (!when)
+			return;
+		group = SCHEDULE_GROUP_TIME;
+	}
+	if (entry.start)
+		wheel.Add(when - lead, group, [this, entry] { prepare(entry); });
+	wheel.Add(when, group, [this, entry, when] { Fire(entry, when); });
+}
+
+void OutputScheduler::Fire(const schedule_entry &entry, time_t deadline)
+{
+	const int group = entry.trigger == SCHEDULE_AFTER_MAIN ? SCHEDULE_GROUP_MAIN : SCHEDULE_GROUP_TIME;
+	if (!fire(entry)) {
+		wheel.Add(deadline + 1, group, [this, entry, deadline] { Fire(entry, deadline + 1); });
+		return;
+	}
+	blog(LOG_INFO, "[Aitum Multistream] scheduled %s of '%s'", entry.start ? "start" : "stop", entry.name.c_str());
+	if (entry.trigger == SCHEDULE_TIME_OF_DAY)
+		Arm(entry, deadline);
+}
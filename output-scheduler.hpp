@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define SCHEDULE_WHEEL_SLOTS 64
+#define SCHEDULE_DEFAULT_LEAD 30
+
+enum schedule_trigger {
+	SCHEDULE_TIME_OF_DAY = 0,
+	SCHEDULE_AFTER_MAIN = 1,
+};
+
+struct schedule_entry {
+	std::string name;
+	bool vertical = false;
+	bool start = true;
+	schedule_trigger trigger = SCHEDULE_TIME_OF_DAY;
+	// Seconds after local midnight or after the main stream went live
+	int64_t seconds = 0;
+	// One bit per weekday starting on Sunday, 0 for every day
+	uint8_t days = 0;
+};
+
+// Parses a list like "T+0; T+1:30:00; mon fri 20:00" separated by semicolons, false on the first invalid item
+bool schedule_parse(const char *text, const std::string &name, bool vertical, bool start, std::vector<schedule_entry> &entries);
+
+// Next local time after now a time of day entry fires
+time_t schedule_next_time(const schedule_entry &entry, time_t now);
+
+// Hashed timer wheel with a resolution of one second. Timers land in the slot of their deadline and a tick only looks
+// at the slots it passes, so the cost does not grow with the number of armed schedules.
+class TimerWheel {
+public:
+	typedef std::function<void()> task;
+
+	void Reset(time_t now);
+	void Add(time_t deadline, int group, task run);
+	void CancelGroup(int group);
+	void Advance(time_t now);
+
+private:
+	struct timer {
+		time_t deadline;
+		int group;
+		task run;
+	};
+	std::vector<timer> slots[SCHEDULE_WHEEL_SLOTS];
+	time_t current = 0;
+};
+
+// Arms the schedules of a profile on the wheel. Starts get a prepare call lead seconds ahead, so the start itself only has
+// to start the output. A start callback returning false is retried on the next tick.
+class OutputScheduler {
+public:
+	typedef std::function<void(const schedule_entry &entry)> prepare_cb;
+	typedef std::function<bool(const schedule_entry &entry)> fire_cb;
+
+	OutputScheduler(prepare_cb prepare, fire_cb fire);
+
+	void Load(std::vector<schedule_entry> entries, int lead, time_t now);
+	void MainStarted(time_t now);
+	void MainStopped();
+	void Tick(time_t now);
+
+private:
+	prepare_cb prepare;
+	fire_cb fire;
+	TimerWheel wheel;
+	std::vector<schedule_entry> entries;
+	int lead = SCHEDULE_DEFAULT_LEAD;
+	time_t mainStart = 0;
+	bool ticking = false;
+
+	void Arm(const schedule_entry &entry, time_t now);
+	void Fire(const schedule_entry &entry, time_t deadline);
+};
@@ -0,0 +1,448 @@
+#include "plugin-api.hpp"
+#include "abr-controller.hpp"
+#include "multistream.hpp"
+#include <obs-module.h>
+#include <util/platform.h>
+#include <algorithm>
+#include <ctime>
+#include <functional>
+
+#define API_VENDOR_NAME "aitum-multistream"
+
+static MultistreamDock *api_dock = nullptr;
+
+static void api_task(void *param)
+{
+	(*(std::function<void()> *)param)();
+}
+
+// The dock lives on the UI thread, procs and vendor requests can come from any thread
+static void run_on_ui(std::function<void()> f)
+{
+	obs_queue_task(OBS_TASK_UI, api_task, &f, true);
+}
+
+static obs_data_array_t *api_list_outputs()
+{
+	obs_data_array_t *outputs = nullptr;
+	run_on_ui([&outputs] {
+		if (api_dock)
+			outputs = api_dock->ApiListOutputs();
+	});
+	return outputs ? outputs : obs_data_array_create();
+}
+
+static obs_data_t *api_get_stats()
+{
+	obs_data_t *stats = nullptr;
+	run_on_ui([&stats] {
+		if (api_dock)
+			stats = api_dock->ApiGetStats();
+	});
+	return stats ? stats : obs_data_create();
+}
+
+static bool api_start_stop(const char *name, bool vertical, bool start, std::string &error)
+{
+	bool success = false;
+	if (!name || !*name) {
+		error = "no output name";
+		return false;
+	}
+	run_on_ui([&] {
+		if (!api_dock)
+			error = "not loaded";
+		else if (start)
+			success = api_dock->ApiStartOutput(name, vertical, error);
+		else
+			success = api_dock->ApiStopOutput(name, vertical, error);
+	});
+	return success;
+}
+
+// Starts all outputs in one pass on the UI thread
+static obs_data_array_t *api_start_many(obs_data_array_t *outputs)
+{
+	auto results = obs_data_array_create();
+	run_on_ui([outputs, results] {
+		size_t count = obs_data_array_count(outputs);
+		for (size_t i = 0; i < count; i++) {
+			auto output = obs_data_array_item(outputs, i);
+			auto name = obs_data_get_string(output, "name");
+			std::string error;
+			bool success = false;
+			if (!api_dock)
+				error = "not loaded";
+			else if (!*name)
+				error = "no output name";
+			else
+				success = api_dock->ApiStartOutput(name, obs_data_get_bool(output, "vertical"), error);
+			auto result = obs_data_create();
+			obs_data_set_string(result, "name", name);
+			obs_data_set_bool(result, "vertical", obs_data_get_bool(output, "vertical"));
+			obs_data_set_bool(result, "success", success);
+			if (!success)
+				obs_data_set_string(result, "error", error.c_str());
+			obs_data_array_push_back(results, result);
+			obs_data_release(result);
+			obs_data_release(output);
+		}
+	});
+	return results;
+}
+
+static void proc_get_api_version(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	calldata_set_int(cd, "version", AITUM_MULTISTREAM_API_VERSION);
+}
+
+static void proc_list_outputs(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	calldata_set_ptr(cd, "outputs", api_list_outputs());
+}
+
+static void proc_start_stop(calldata_t *cd, bool start)
+{
+	std::string error;
+	bool success = api_start_stop(calldata_string(cd, "name"), calldata_bool(cd, "vertical"), start, error);
+	calldata_set_bool(cd, "success", success);
+	calldata_set_string(cd, "error", error.c_str());
+}
+
+static void proc_start(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	proc_start_stop(cd, true);
+}
+
+static void proc_stop(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	proc_start_stop(cd, false);
+}
+
+static void proc_start_many(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	calldata_set_ptr(cd, "results", api_start_many((obs_data_array_t *)calldata_ptr(cd, "outputs")));
+}
+
+static void proc_get_stats(void *data, calldata_t *cd)
+{
+	UNUSED_PARAMETER(data);
+	calldata_set_ptr(cd, "stats", api_get_stats());
+}
+
+void plugin_api_register(MultistreamDock *dock)
+{
+	api_dock = dock;
+	auto ph = obs_get_proc_handler();
+	proc_handler_add(ph, "void aitum_multistream_get_api_version(out int version)", proc_get_api_version, nullptr);
+	proc_handler_add(ph, "void aitum_multistream_list_outputs(out ptr outputs)", proc_list_outputs, nullptr);
+	proc_handler_add(ph, "void aitum_multistream_start(in string name, in bool vertical, out bool success, out string error)",
+			 proc_start, nullptr);
+	proc_handler_add(ph, "void aitum_multistream_stop(in string name, in bool vertical, out bool success, out string error)",
+			 proc_stop, nullptr);
+	proc_handler_add(ph, "void aitum_multistream_start_many(in ptr outputs, out ptr results)", proc_start_many, nullptr);
+	proc_handler_add(ph, "void aitum_multistream_get_stats(out ptr stats)", proc_get_stats, nullptr);
+}
+
+// obs-websocket vendor requests, the same protocol as obs-websocket-api.h without depending on its header
+typedef void (*obs_websocket_request_callback_function)(obs_data_t *, obs_data_t *, void *);
+
+struct obs_websocket_request_callback {
+	obs_websocket_request_callback_function callback;
+	void *priv_data;
+};
+
+static proc_handler_t *websocket_ph = nullptr;
+static void *websocket_vendor = nullptr;
+
+static void vendor_get_api_version(obs_data_t *request, obs_data_t *response, void *data)
+{
+	UNUSED_PARAMETER(request);
+	UNUSED_PARAMETER(data);
+	obs_data_set_int(response, "version", AITUM_MULTISTREAM_API_VERSION);
+}
+
+static void vendor_list_outputs(obs_data_t *request, obs_data_t *response, void *data)
+{
+	UNUSED_PARAMETER(request);
+	UNUSED_PARAMETER(data);
+	auto outputs = api_list_outputs();
+	obs_data_set_array(response, "outputs", outputs);
+	obs_data_array_release(outputs);
+}
+
+static void vendor_start_stop(obs_data_t *request, obs_data_t *response, bool start)
+{
+	std::string error;
+	bool success =
+		api_start_stop(obs_data_get_string(request, "name"), obs_data_get_bool(request, "vertical"), start, error);
+	obs_data_set_bool(response, "success", success);
+	if (!success)
+		obs_data_set_string(response, "error", error.c_str());
+}
+
+static void vendor_start_output(obs_data_t *request, obs_data_t *response, void *data)
+{
+	UNUSED_PARAMETER(data);
+	vendor_start_stop(request, response, true);
+}
+
+static void vendor_stop_output(obs_data_t *request, obs_data_t *response, void *data)
+{
+	UNUSED_PARAMETER(data);
+	vendor_start_stop(request, response, false);
+}
+
+static void vendor_start_outputs(obs_data_t *request, obs_data_t *response, void *data)
+{
+	UNUSED_PARAMETER(data);
+	auto outputs = obs_data_get_array(request, "outputs");
+	auto results = api_start_many(outputs);
+	obs_data_array_release(outputs);
+	obs_data_set_array(response, "results", results);
+	obs_data_array_release(results);
+}
+
+static void vendor_get_stats(obs_data_t *request, obs_data_t *response, void *data)
+{
+	UNUSED_PARAMETER(request);
+	UNUSED_PARAMETER(data);
+	auto stats = api_get_stats();
+	obs_data_apply(response, stats);
+	obs_data_release(stats);
+}
+
+static const struct {
+	const char *type;
+	obs_websocket_request_callback_function callback;
+} vendor_requests[] = {
+	{"GetApiVersion", vendor_get_api_version},
+	{"ListOutputs", vendor_list_outputs},
+	{"StartOutput", vendor_start_output},
+	{"StopOutput", vendor_stop_output},
+	{"StartOutputs", vendor_start_outputs},
+	{"GetStats", vendor_get_stats},
+};
+
+void plugin_api_register_vendor()
+{
+	struct calldata cd;
+	calldata_init(&cd);
+	if (proc_handler_call(obs_get_proc_handler(), "obs_websocket_api_get_ph", &cd))
+		websocket_ph = (proc_handler_t *)calldata_ptr(&cd, "ph");
+	calldata_free(&cd);
+	if (!websocket_ph)
+		return;
+
+	calldata_init(&cd);
+	calldata_set_string(&cd, "name", API_VENDOR_NAME);
+	proc_handler_call(websocket_ph, "vendor_register", &cd);
+	websocket_vendor = calldata_ptr(&cd, "vendor");
+	calldata_free(&cd);
+	if (!websocket_vendor) {
+		blog(LOG_WARNING, "[Aitum Multistream] failed to register obs-websocket vendor");
+		return;
+	}
+	for (auto &request : vendor_requests) {
+		struct obs_websocket_request_callback cb = {request.callback, nullptr};
+		calldata_init(&cd);
+		calldata_set_ptr(&cd, "vendor", websocket_vendor);
+		calldata_set_string(&cd, "type", request.type);
+		calldata_set_ptr(&cd, "callback", &cb);
+		proc_handler_call(websocket_ph, "vendor_request_register", &cd);
+		if (!calldata_bool(&cd, "success"))
+			blog(LOG_WARNING, "[Aitum Multistream] failed to register obs-websocket request %s", request.type);
+		calldata_free(&cd);
+	}
+	blog(LOG_INFO, "[Aitum Multistream] registered obs-websocket vendor %s", API_VENDOR_NAME);
+}
+
+void plugin_api_unregister()
+{
+	// Procs stay registered on the global proc handler, they do nothing once the dock is gone
+	api_dock = nullptr;
+	if (!websocket_vendor)
+		return;
+	for (auto &request : vendor_requests) {
+		struct calldata cd;
+		calldata_init(&cd);
+		calldata_set_ptr(&cd, "vendor", websocket_vendor);
+		calldata_set_string(&cd, "type", request.type);
+		proc_handler_call(websocket_ph, "vendor_request_unregister", &cd);
+		calldata_free(&cd);
+	}
+	websocket_vendor = nullptr;
+}
+
+obs_output_t *MultistreamDock::GetOutput(const char *name, bool vertical)
+{
+	if (vertical)
+		return ResolveVerticalOutput(name);
+	for (auto it = outputs.begin(); it != outputs.end(); it++) {
+		if (std::get<std::string>(*it) == name)
+			return obs_output_get_ref(std::get<obs_output_t *>(*it));
+	}
+	auto record = recordOutputs.find(name);
+	if (record != recordOutputs.end())
+		return obs_output_get_ref(record->second);
+	return nullptr;
+}
+
+static void api_enum_outputs(obs_data_array_t *outputs, bool vertical,
+			     const std::function<void(obs_data_t *settings, bool vertical)> &f)
+{
+	size_t count = obs_data_array_count(outputs);
+	for (size_t i = 0; i < count; i++) {
+		auto settings = obs_data_array_item(outputs, i);
+		f(settings, vertical);
+		obs_data_release(settings);
+	}
+}
+
+obs_data_array_t *MultistreamDock::ApiListOutputs()
+{
+	auto list = obs_data_array_create();
+	auto add = [this, list](obs_data_t *settings, bool vertical) {
+		auto name = obs_data_get_string(settings, "name");
+		auto server = obs_data_get_string(settings, "stream_server");
+		auto item = obs_data_create();
+		obs_data_set_string(item, "name", name);
+		obs_data_set_bool(item, "vertical", vertical);
+		obs_data_set_string(item, "server", transport_display_url(server).c_str());
+		transport t;
+		obs_data_set_string(item, "protocol", transport_from_server(server, t) ? transport_protocol_name(t.protocol) : "");
+		auto output = GetOutput(name, vertical);
+		obs_data_set_bool(item, "active", obs_output_active(output));
+		obs_output_release(output);
+		obs_data_array_push_back(list, item);
+		obs_data_release(item);
+	};
+	auto main_outputs = current_config ? obs_data_get_array(current_config, "outputs") : nullptr;
+	api_enum_outputs(main_outputs, false, add);
+	obs_data_array_release(main_outputs);
+	api_enum_outputs(vertical_outputs, true, add);
+	return list;
+}
+
+obs_data_t *MultistreamDock::ApiGetStats()
+{
+	auto stats = obs_data_create();
+	auto list = obs_data_array_create();
+	auto add = [this, list](obs_data_t *settings, bool vertical) {
+		auto name = obs_data_get_string(settings, "name");
+		auto item = obs_data_create();
+		obs_data_set_string(item, "name", name);
+		obs_data_set_bool(item, "vertical", vertical);
+		auto output = GetOutput(name, vertical);
+		const bool active = obs_output_active(output);
+		obs_data_set_bool(item, "active", active);
+		if (output) {
+			obs_data_set_int(item, "total_bytes", (long long)obs_output_get_total_bytes(output));
+			obs_data_set_int(item, "kbps", active ? bandwidthBudget.GetKbps(obs_output_get_name(output)) : 0);
+			obs_data_set_int(item, "frames_dropped", obs_output_get_frames_dropped(output));
+			obs_data_set_int(item, "total_frames", obs_output_get_total_frames(output));
+			obs_data_set_double(item, "congestion", obs_output_get_congestion(output));
+			obs_data_set_int(item, "connect_time_ms", obs_output_get_connect_time_ms(output));
+			obs_data_set_bool(item, "reconnecting", obs_output_reconnecting(output));
+		}
+		obs_output_release(output);
+		auto abr = vertical ? abrControllers.end() : abrControllers.find(name);
+		if (abr != abrControllers.end())
+			obs_data_set_int(item, "abr_bitrate", abr->second->GetBitrate());
+		obs_data_array_push_back(list, item);
+		obs_data_release(item);
+	};
+	auto main_outputs = current_config ? obs_data_get_array(current_config, "outputs") : nullptr;
+	api_enum_outputs(main_outputs, false, add);
+	obs_data_array_release(main_outputs);
+	api_enum_outputs(vertical_outputs, true, add);
+
+	obs_data_set_int(stats, "timestamp", (long long)time(nullptr));
+	obs_data_set_bool(stats, "main_active", obs_frontend_streaming_active());
+	obs_data_set_int(stats, "upload_kbps", bandwidthBudget.GetUsage());
+	obs_data_set_int(stats, "upload_budget", obs_data_get_int(current_config, "upload_budget"));
+	obs_data_set_int(stats, "lagged_frames", obs_get_lagged_frames());
+	obs_data_set_int(stats, "rendered_frames", obs_get_total_frames());
+	obs_data_set_array(stats, "outputs", list);
+	obs_data_array_release(list);
+	return stats;
+}
+
+bool MultistreamDock::ApiStartOutput(const char *name, bool vertical, std::string &error)
+{
+	auto rowName = QString::fromUtf8(name);
+	if (FindOutputRow(rowName, vertical) < 0) {
+		error = "output not found";
+		return false;
+	}
+	auto output = GetOutput(name, vertical);
+	const bool active = obs_output_active(output);
+	obs_output_release(output);
+	if (active)
+		return true;
+
+	blog(LOG_INFO, "[Aitum Multistream] start stream requested through the API '%s'", name);
+	bool started = false;
+	if (vertical) {
+		struct calldata cd;
+		calldata_init(&cd);
+		calldata_set_string(&cd, "name", name);
+		started = proc_handler_call(obs_get_proc_handler(), "aitum_vertical_start_stream_output", &cd);
+		calldata_free(&cd);
+		if (started) {
+			liveJournal.Record(name, true, true);
+			obs_output_release(ResolveVerticalOutput(name));
+		} else {
+			error = "vertical plugin not available";
+		}
+	} else {
+		obs_data_t *settings = nullptr;
+		auto main_outputs = obs_data_get_array(current_config, "outputs");
+		api_enum_outputs(main_outputs, false, [name, &settings](obs_data_t *s, bool) {
+			if (!settings && strcmp(obs_data_get_string(s, "name"), name) == 0)
+				settings = s;
+		});
+		// The settings stay owned by current_config like the ones the dock buttons use
+		obs_data_array_release(main_outputs);
+		started = settings && StartOutput(settings, false);
+		if (!started) {
+			auto row = FindOutputRow(rowName, false);
+			error = row >= 0 ? mainRows->Row(row).badge.message : std::string();
+			if (error.empty())
+				error = "failed to start";
+		}
+	}
+	if (started)
+		SetOutputChecked(rowName, vertical, true);
+	return started;
+}
+
+bool MultistreamDock::ApiStopOutput(const char *name, bool vertical, std::string &error)
+{
+	auto rowName = QString::fromUtf8(name);
+	if (FindOutputRow(rowName, vertical) < 0) {
+		error = "output not found";
+		return false;
+	}
+	blog(LOG_INFO, "[Aitum Multistream] stop stream requested through the API '%s'", name);
+	if (vertical) {
+		struct calldata cd;
+		calldata_init(&cd);
+		calldata_set_string(&cd, "name", name);
+		proc_handler_call(obs_get_proc_handler(), "aitum_vertical_stop_stream_output", &cd);
+		calldata_free(&cd);
+		liveJournal.Record(name, true, false);
+	} else {
+		auto pending = std::find(followPending.begin(), followPending.end(), name);
+		if (pending != followPending.end())
+			followPending.erase(pending);
+		StopOutput(name);
+	}
+	SetOutputChecked(rowName, vertical, false);
+	return true;
+}
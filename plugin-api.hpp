@@ -0,0 +1,20 @@
+#pragma once
+
+// Bumped when a proc or vendor request changes in a way that breaks existing callers
+#define AITUM_MULTISTREAM_API_VERSION 1
+
+class MultistreamDock;
+
+// Global procs for other plugins and scripts:
+//   void aitum_multistream_get_api_version(out int version)
+//   void aitum_multistream_list_outputs(out ptr outputs)                              obs_data_array_t, caller releases
+//   void aitum_multistream_start(in string name, in bool vertical, out bool success, out string error)
+//   void aitum_multistream_stop(in string name, in bool vertical, out bool success, out string error)
+//   void aitum_multistream_start_many(in ptr outputs, out ptr results)                obs_data_array_t of name and vertical
+//   void aitum_multistream_get_stats(out ptr stats)                                   obs_data_t, caller releases
+void plugin_api_register(MultistreamDock *dock);
+
+// The same calls as obs-websocket vendor requests of the "aitum-multistream" vendor, obs-websocket has to be loaded
+void plugin_api_register_vendor();
+
+void plugin_api_unregister();
@@ -0,0 +1,185 @@
+#include "preflight.hpp"
+#include "stream-output.hpp"
+#include <obs-module.h>
+#include <obs-frontend-api.h>
+#include <curl/curl.h>
+#include <cstring>
+
+static bool encoder_type_exists(const char *id, obs_encoder_type type)
+{
+	const char *t;
+	size_t idx = 0;
+	while (obs_enum_encoder_types(idx++, &t)) {
+		if (strcmp(t, id) == 0)
+			return obs_get_encoder_type(t) == type;
+	}
+	return false;
+}
+
+static preflight_result preflight_error(preflight_status status, const char *text)
+{
+	preflight_result result;
+	result.status = status;
+	result.message = obs_module_text(text);
+	return result;
+}
+
+preflight_result preflight_validate(obs_data_t *settings, bool vertical)
+{
+	if (!settings)
+		return preflight_error(PREFLIGHT_ERROR, "PreflightNoSettings");
+
+	// Warnings do not stop a start, the first one is reported unless an error turns up
+	auto result = preflight_error(PREFLIGHT_OK, "PreflightOk");
+
+	if (!vertical && obs_data_get_int(settings, "record_mode") == RECORD_MODE_RECORD) {
+		// Record only, nothing to check on the network side
+	} else {
+		auto server = obs_data_get_string(settings, "stream_server");
+		if (!server || !*server)
+			server = obs_data_get_string(settings, "server");
+		if (!server || !*server)
+			return preflight_error(PREFLIGHT_ERROR, "PreflightNoServer");
+		stream_url url;
+		if (!parse_stream_url(server, url))
+			return preflight_error(PREFLIGHT_ERROR, "PreflightInvalidServer");
+		transport t;
+		// Any other scheme goes to the MPEG-TS muxer, which may well handle it
+		if (!transport_from_server(server, t))
+			result = preflight_error(PREFLIGHT_WARNING, "PreflightUnsupportedProtocol");
+		if (t.needs_port && !t.url.port)
+			return preflight_error(PREFLIGHT_ERROR, "PreflightNoPort");
+		auto key = obs_data_get_string(settings, "stream_key");
+		if (!key || !*key)
+			key = obs_data_get_string(settings, "key");
+		// The key can be part of a custom server URL
+		if ((!key || !*key) && t.needs_key && result.status == PREFLIGHT_OK)
+			result = preflight_error(PREFLIGHT_WARNING, "PreflightNoKey");
+		// SRT only accepts passphrases of 10 to 79 characters
+		size_t passphrase = strlen(obs_data_get_string(settings, "transport_passphrase"));
+		if (t.protocol == TRANSPORT_SRT && !vertical && passphrase && (passphrase < 10 || passphrase > 79))
+			return preflight_error(PREFLIGHT_ERROR, "PreflightInvalidPassphrase");
+	}
+	if (vertical)
+		return result;
+
+	const bool advanced = obs_data_get_bool(settings, "advanced");
+	auto venc_name = advanced ? obs_data_get_string(settings, "video_encoder") : "";
+	auto aenc_name = advanced ? obs_data_get_string(settings, "audio_encoder") : "";
+	if (venc_name && *venc_name && !encoder_type_exists(venc_name, OBS_ENCODER_VIDEO))
+		return preflight_error(PREFLIGHT_ERROR, "PreflightVideoEncoderMissing");
+	if (aenc_name && *aenc_name && !encoder_type_exists(aenc_name, OBS_ENCODER_AUDIO))
+		return preflight_error(PREFLIGHT_ERROR, "PreflightAudioEncoderMissing");
+
+	const bool main_video = !venc_name || !*venc_name;
+	const bool main_audio = !aenc_name || !*aenc_name;
+	if (!main_video && !main_audio)
+		return result;
+
+	auto main_output = obs_frontend_get_streaming_output();
+	if (!main_output || !obs_output_active(main_output)) {
+		obs_output_release(main_output);
+		return result.status == PREFLIGHT_OK ? preflight_error(PREFLIGHT_WARNING, "MainOutputNotActive") : result;
+	}
+	auto vei = advanced ? (size_t)obs_data_get_int(settings, "video_encoder_index") : 0;
+	auto aei = advanced ? (size_t)obs_data_get_int(settings, "audio_encoder_index") : 0;
+	bool found = true;
+	if (main_video)
+		found = obs_output_get_video_encoder2(main_output, vei) != nullptr;
+	if (main_audio && found)
+		found = obs_output_get_audio_encoder(main_output, aei) != nullptr;
+	obs_output_release(main_output);
+	if (!found)
+		return preflight_error(PREFLIGHT_ERROR, "MainOutputEncoderIndexNotFound");
+	return result;
+}
+
+static int preflight_progress(void *param, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+{
+	UNUSED_PARAMETER(dltotal);
+	UNUSED_PARAMETER(dlnow);
+	UNUSED_PARAMETER(ultotal);
+	UNUSED_PARAMETER(ulnow);
+	return *(const std::atomic<bool> *)param ? 1 : 0;
+}
+
+preflight_result PreflightProbe::Probe(const std::string &server, const std::atomic<bool> &aborted)
+{
+	transport t;
+	if (!transport_from_server(server.c_str(), t))
+		return preflight_error(PREFLIGHT_WARNING, "PreflightUnsupportedProtocol");
+
+	// Only TCP based protocols can be probed, for the secure ones curl does the TLS handshake
+	std::string probe_scheme;
+	auto &url = t.url;
+	int port = url.port;
+	if (t.protocol == TRANSPORT_RTMP || (t.protocol == TRANSPORT_MPEGTS && url.scheme == "tcp") || url.scheme == "http") {
+		probe_scheme = "http";
+		if (!port)
+			port = url.scheme == "http" ? 80 : 1935;
+	} else if (t.protocol == TRANSPORT_RTMPS || url.scheme == "https") {
+		probe_scheme = "https";
+		if (!port)
+			port = 443;
+	} else {
+		return preflight_error(PREFLIGHT_OK, "PreflightNotProbed");
+	}
+	std::string host = url.host.find(':') != std::string::npos ? "[" + url.host + "]" : url.host;
+	std::string probe_url = probe_scheme + "://" + host + ":" + std::to_string(port) + "/";
+
+	CURL *curl = curl_easy_init();
+	if (!curl)
+		return preflight_error(PREFLIGHT_WARNING, "PreflightNotProbed");
+	curl_easy_setopt(curl, CURLOPT_URL, probe_url.c_str());
+	curl_easy_setopt(curl, CURLOPT_CONNECT_ONLY, 1L);
+	curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, 3000L);
+	curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+	curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+	curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, preflight_progress);
+	curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &aborted);
+	CURLcode code = curl_easy_perform(curl);
+	curl_easy_cleanup(curl);
+	if (code == CURLE_OK)
+		return preflight_error(PREFLIGHT_OK, "PreflightReachable");
+
+	preflight_result result = preflight_error(PREFLIGHT_ERROR, "PreflightUnreachable");
+	result.message += " (";
+	result.message += curl_easy_strerror(code);
+	result.message += ")";
+	return result;
+}
+
+PreflightProbe::PreflightProbe(result_cb callback_) : callback(callback_) {}
+
+PreflightProbe::~PreflightProbe()
+{
+	Abort();
+	for (auto &thread : threads) {
+		if (thread.joinable())
+			thread.join();
+	}
+}
+
+void PreflightProbe::Add(const std::string &name, const std::string &server)
+{
+	queued.emplace_back(name, server);
+}
+
+void PreflightProbe::Start()
+{
+	pending += queued.size();
+	for (auto &q : queued) {
+		threads.emplace_back([this, q] {
+			auto result = Probe(q.second, aborted);
+			if (!aborted)
+				callback(q.first, result);
+			pending--;
+		});
+	}
+	queued.clear();
+}
+
+void PreflightProbe::Abort()
+{
+	aborted = true;
+}
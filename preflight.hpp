@@ -0,0 +1,48 @@
+#pragma once
+
+#include "transport.hpp"
+#include <obs.h>
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum preflight_status {
+	PREFLIGHT_UNKNOWN = 0,
+	PREFLIGHT_OK = 1,
+	PREFLIGHT_WARNING = 2,
+	PREFLIGHT_ERROR = 3,
+};
+
+struct preflight_result {
+	preflight_status status = PREFLIGHT_UNKNOWN;
+	std::string message;
+};
+
+// Checks an output configuration without touching the network
+preflight_result preflight_validate(obs_data_t *settings, bool vertical);
+
+// Connects to the ingest of every queued destination in parallel, TLS included for secure protocols.
+// The callback is called from the probe threads.
+class PreflightProbe {
+public:
+	typedef std::function<void(const std::string &name, const preflight_result &result)> result_cb;
+
+	PreflightProbe(result_cb callback);
+	~PreflightProbe();
+
+	void Add(const std::string &name, const std::string &server);
+	void Start();
+	void Abort();
+	bool Finished() const { return pending == 0; }
+
+	static preflight_result Probe(const std::string &server, const std::atomic<bool> &aborted);
+
+private:
+	result_cb callback;
+	std::vector<std::pair<std::string, std::string>> queued;
+	std::vector<std::thread> threads;
+	std::atomic<bool> aborted = false;
+	std::atomic<size_t> pending = 0;
+};
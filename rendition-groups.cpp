@@ -0,0 +1,145 @@
+#include "rendition-groups.hpp"
+
+static const char *scale_type_name(obs_scale_type scale_type)
+{
+	switch (scale_type) {
+	case OBS_SCALE_DISABLE:
+		return "unscaled";
+	case OBS_SCALE_POINT:
+		return "point";
+	case OBS_SCALE_BICUBIC:
+		return "bicubic";
+	case OBS_SCALE_BILINEAR:
+		return "bilinear";
+	case OBS_SCALE_LANCZOS:
+		return "lanczos";
+	case OBS_SCALE_AREA:
+		return "area";
+	}
+	return "unknown";
+}
+
+// Scaled without a GPU scale type, libobs gives the encoder a scaler of its own on the CPU
+static bool is_cpu_scaled(video_t *video, uint32_t width, uint32_t height, obs_scale_type scale_type)
+{
+	return scale_type == OBS_SCALE_DISABLE &&
+	       (width != video_output_get_width(video) || height != video_output_get_height(video));
+}
+
+RenditionGroups::~RenditionGroups()
+{
+	for (auto &r : renditions) {
+		for (auto weak : r.encoders)
+			obs_weak_encoder_release(weak);
+	}
+}
+
+void RenditionGroups::Attach(obs_encoder_t *encoder, video_t *video, uint32_t width, uint32_t height,
+			     obs_scale_type scale_type, uint32_t divisor)
+{
+	if (!encoder || !video)
+		return;
+	obs_encoder_set_video(encoder, video);
+	if (divisor > 1)
+		obs_encoder_set_frame_rate_divisor(encoder, divisor);
+	else
+		divisor = 1;
+
+	if (!width || !height || (width == video_output_get_width(video) && height == video_output_get_height(video))) {
+		// Canvas size, the encoder takes the canvas frames without a scale pass
+		width = video_output_get_width(video);
+		height = video_output_get_height(video);
+		scale_type = OBS_SCALE_DISABLE;
+	} else {
+		obs_encoder_set_scaled_size(encoder, width, height);
+		if (scale_type != OBS_SCALE_DISABLE)
+			obs_encoder_set_gpu_scale_type(encoder, scale_type);
+		else
+			blog(LOG_INFO, "[Aitum Multistream] encoder '%s' scales to %ux%u on the CPU and shares no scaled mix",
+			     obs_encoder_get_name(encoder), width, height);
+	}
+	const bool cpu_scaled = is_cpu_scaled(video, width, height, scale_type);
+
+	Prune();
+	rendition *group = nullptr;
+	for (auto &r : renditions) {
+		if (cpu_scaled || r.video != video || r.width != width || r.height != height || r.divisor != divisor)
+			continue;
+		if (r.scale_type == scale_type) {
+			group = &r;
+			break;
+		}
+		// The scale filter the user picked wins over sharing a mix
+		if (r.scale_type != OBS_SCALE_DISABLE && scale_type != OBS_SCALE_DISABLE)
+			blog(LOG_INFO, "[Aitum Multistream] encoder '%s' scales to %ux%u with %s, not sharing the %s mix",
+			     obs_encoder_get_name(encoder), width, height, scale_type_name(scale_type),
+			     scale_type_name(r.scale_type));
+	}
+	if (!group) {
+		renditions.push_back({video, width, height, scale_type, divisor, {}});
+		group = &renditions.back();
+	} else {
+		blog(LOG_INFO, "[Aitum Multistream] encoder '%s' shares the %ux%u %s rendition with %d other encoder(s)",
+		     obs_encoder_get_name(encoder), width, height, scale_type_name(scale_type), (int)group->encoders.size());
+	}
+	group->encoders.push_back(obs_encoder_get_weak_encoder(encoder));
+}
+
+void RenditionGroups::Prune()
+{
+	for (auto it = renditions.begin(); it != renditions.end();) {
+		auto &encoders = it->encoders;
+		for (auto e = encoders.begin(); e != encoders.end();) {
+			auto encoder = obs_weak_encoder_get_encoder(*e);
+			if (encoder) {
+				obs_encoder_release(encoder);
+				e++;
+			} else {
+				obs_weak_encoder_release(*e);
+				e = encoders.erase(e);
+			}
+		}
+		if (encoders.empty())
+			it = renditions.erase(it);
+		else
+			it++;
+	}
+}
+
+std::string RenditionGroups::Report()
+{
+	Prune();
+	size_t encoders = 0;
+	size_t scaled = 0;
+	size_t cpu_scaled = 0;
+	std::vector<const rendition *> passes;
+	std::string lines;
+	for (auto &r : renditions) {
+		encoders += r.encoders.size();
+		const bool cpu = is_cpu_scaled(r.video, r.width, r.height, r.scale_type);
+		double fps = video_output_get_frame_rate(r.video) / (double)r.divisor;
+		lines += "  " + std::to_string(r.width) + "x" + std::to_string(r.height) + " " +
+			 (cpu ? "cpu" : scale_type_name(r.scale_type)) + " " + std::to_string((int)(fps + 0.5)) +
+			 "fps: " + std::to_string(r.encoders.size()) + " encoder(s)\n";
+		if (cpu) {
+			// Every CPU scaled encoder is a scale pass of its own
+			cpu_scaled += r.encoders.size();
+			continue;
+		}
+		if (r.scale_type == OBS_SCALE_DISABLE)
+			continue;
+		scaled += r.encoders.size();
+		// The scaled mix is shared across frame rate divisors, the divisor only drops frames
+		bool found = false;
+		for (auto p : passes)
+			found = found || (p->video == r.video && p->width == r.width && p->height == r.height &&
+					  p->scale_type == r.scale_type);
+		if (!found)
+			passes.push_back(&r);
+	}
+	std::string report = "Renditions: " + std::to_string(encoders) + " custom video encoder(s), " +
+			     std::to_string(passes.size() + cpu_scaled) + " scale pass(es) for " +
+			     std::to_string(scaled + cpu_scaled) + " scaled encoder(s), " +
+			     std::to_string(scaled - passes.size()) + " saved, " + std::to_string(cpu_scaled) + " on the CPU\n";
+	return report + lines;
+}
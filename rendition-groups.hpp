@@ -0,0 +1,30 @@
+#pragma once
+
+#include <obs.h>
+#include <string>
+#include <vector>
+
+// Groups the custom video encoders by the rendition they encode: canvas, size, scale filter and frame rate divisor.
+// Encoders of the same size and GPU scale filter share one scaled mix in libobs instead of a scale pass per encoder. The
+// scale filter of each output is kept as configured, encoders without a GPU filter are scaled on the CPU on their own.
+class RenditionGroups {
+public:
+	~RenditionGroups();
+
+	void Attach(obs_encoder_t *encoder, video_t *video, uint32_t width, uint32_t height, obs_scale_type scale_type,
+		    uint32_t divisor);
+	std::string Report();
+
+private:
+	struct rendition {
+		video_t *video;
+		uint32_t width;
+		uint32_t height;
+		obs_scale_type scale_type;
+		uint32_t divisor;
+		std::vector<obs_weak_encoder_t *> encoders;
+	};
+	std::vector<rendition> renditions;
+
+	void Prune();
+};
@@ -0,0 +1,117 @@
+#include "settings-diff.hpp"
+#include <algorithm>
+
+obs_data_t *settings_copy(obs_data_t *settings)
+{
+	if (!settings)
+		return obs_data_create();
+	return obs_data_create_from_json(obs_data_get_json(settings));
+}
+
+std::string settings_array_json(obs_data_array_t *array)
+{
+	if (!array)
+		return "";
+	auto data = obs_data_create();
+	obs_data_set_array(data, "a", array);
+	std::string json = obs_data_get_json(data);
+	obs_data_release(data);
+	return json;
+}
+
+static void copy_item(obs_data_t *target, obs_data_item_t *item)
+{
+	auto name = obs_data_item_get_name(item);
+	switch (obs_data_item_gettype(item)) {
+	case OBS_DATA_STRING:
+		obs_data_set_string(target, name, obs_data_item_get_string(item));
+		break;
+	case OBS_DATA_NUMBER:
+		if (obs_data_item_numtype(item) == OBS_DATA_NUM_DOUBLE)
+			obs_data_set_double(target, name, obs_data_item_get_double(item));
+		else
+			obs_data_set_int(target, name, obs_data_item_get_int(item));
+		break;
+	case OBS_DATA_BOOLEAN:
+		obs_data_set_bool(target, name, obs_data_item_get_bool(item));
+		break;
+	case OBS_DATA_OBJECT: {
+		auto obj = obs_data_item_get_obj(item);
+		auto copy = settings_copy(obj);
+		obs_data_set_obj(target, name, copy);
+		obs_data_release(copy);
+		obs_data_release(obj);
+		break;
+	}
+	case OBS_DATA_ARRAY: {
+		auto array = obs_data_item_get_array(item);
+		auto copy = obs_data_array_create();
+		for (size_t i = 0; i < obs_data_array_count(array); i++) {
+			auto entry = obs_data_array_item(array, i);
+			auto entry_copy = settings_copy(entry);
+			obs_data_array_push_back(copy, entry_copy);
+			obs_data_release(entry_copy);
+			obs_data_release(entry);
+		}
+		obs_data_set_array(target, name, copy);
+		obs_data_array_release(copy);
+		obs_data_array_release(array);
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+// A single key serialized on its own, so nested objects and arrays compare by content
+static std::string item_json(obs_data_t *settings, const char *name)
+{
+	auto item = obs_data_item_byname(settings, name);
+	if (!item)
+		return "";
+	std::string json;
+	if (obs_data_item_has_user_value(item)) {
+		auto data = obs_data_create();
+		copy_item(data, item);
+		json = obs_data_get_json(data);
+		obs_data_release(data);
+	}
+	obs_data_item_release(&item);
+	return json;
+}
+
+static void add_keys(obs_data_t *settings, std::vector<std::string> &keys)
+{
+	for (auto item = obs_data_first(settings); item; obs_data_item_next(&item)) {
+		if (!obs_data_item_has_user_value(item))
+			continue;
+		std::string name = obs_data_item_get_name(item);
+		if (std::find(keys.begin(), keys.end(), name) == keys.end())
+			keys.push_back(name);
+	}
+}
+
+std::vector<std::string> settings_changed_keys(obs_data_t *from, obs_data_t *to)
+{
+	std::vector<std::string> keys;
+	add_keys(from, keys);
+	add_keys(to, keys);
+	std::vector<std::string> changed;
+	for (auto &key : keys) {
+		if (item_json(from, key.c_str()) != item_json(to, key.c_str()))
+			changed.push_back(key);
+	}
+	return changed;
+}
+
+void settings_apply_keys(obs_data_t *target, obs_data_t *source, const std::vector<std::string> &keys)
+{
+	for (auto &key : keys) {
+		auto item = obs_data_item_byname(source, key.c_str());
+		if (item && obs_data_item_has_user_value(item))
+			copy_item(target, item);
+		else
+			obs_data_unset_user_value(target, key.c_str());
+		obs_data_item_release(&item);
+	}
+}
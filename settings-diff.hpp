@@ -0,0 +1,17 @@
+#pragma once
+
+#include <obs.h>
+#include <string>
+#include <vector>
+
+// Deep copy, nested objects and arrays are not shared with the source like obs_data_apply does
+obs_data_t *settings_copy(obs_data_t *settings);
+
+// Serialized form of an array, for comparing edited copies against the original
+std::string settings_array_json(obs_data_array_t *array);
+
+// Top level keys whose user value differs between the two, including keys only one of them has
+std::vector<std::string> settings_changed_keys(obs_data_t *from, obs_data_t *to);
+
+// Copies only the given keys, keys without a user value in the source are unset in the target
+void settings_apply_keys(obs_data_t *target, obs_data_t *source, const std::vector<std::string> &keys);
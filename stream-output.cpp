@@ -0,0 +1,138 @@
+#include "stream-output.hpp"
+#include "trace.hpp"
+#include "transport.hpp"
+#include <util/platform.h>
+#include <cstring>
+#include <string>
+
+obs_output_t *create_stream_output(obs_data_t *settings, config_t *profile)
+{
+	auto server = obs_data_get_string(settings, "stream_server");
+	if (!server || !strlen(server)) {
+		server = obs_data_get_string(settings, "server");
+		if (server && strlen(server))
+			obs_data_set_string(settings, "stream_server", server);
+	}
+	transport t;
+	if (!transport_from_server(server, t))
+		blog(LOG_WARNING, "[Aitum Multistream] unknown protocol for stream '%s', using %s",
+		     obs_data_get_string(settings, "name"), t.output_id);
+	auto url = transport_server_url(server, t, settings);
+	auto s = obs_data_create();
+	obs_data_set_string(s, "server", url.c_str());
+	auto key = obs_data_get_string(settings, "stream_key");
+	if (!key || !strlen(key)) {
+		key = obs_data_get_string(settings, "key");
+		if (key && strlen(key))
+			obs_data_set_string(settings, "stream_key", key);
+	}
+	if (t.protocol == TRANSPORT_WHIP) {
+		obs_data_set_string(s, "bearer_token", key);
+	} else {
+		obs_data_set_string(s, "key", key);
+	}
+	//use_auth
+	//username
+	//password
+	std::string service_name = "aitum_multi_service_";
+	service_name += obs_data_get_string(settings, "name");
+	uint64_t phase = os_gettime_ns();
+	auto service = obs_service_create(t.service_id, service_name.c_str(), s, nullptr);
+	trace_record("CreateStreamOutput.service", phase, os_gettime_ns());
+	obs_data_release(s);
+
+	// The service knows best which output it needs, the transport only decides when it has no preference
+	const char *type = obs_service_get_preferred_output_type(service);
+	if (!type)
+		type = t.output_id;
+	std::string output_name = "aitum_multi_output_";
+	output_name += obs_data_get_string(settings, "name");
+	phase = os_gettime_ns();
+	auto output = obs_output_create(type, output_name.c_str(), nullptr, nullptr);
+	trace_record("CreateStreamOutput.output", phase, os_gettime_ns());
+	blog(LOG_INFO, "[Aitum Multistream] stream '%s' uses %s over %s", obs_data_get_string(settings, "name"), type,
+	     transport_protocol_name(t.protocol));
+	obs_output_set_service(output, service);
+
+	const char *bind_ip = obs_data_get_string(settings, "bind_ip");
+	const char *ip_family = obs_data_get_string(settings, "ip_family");
+	if (profile && !*bind_ip)
+		bind_ip = config_get_string(profile, "Output", "BindIP");
+	if (profile && !*ip_family)
+		ip_family = config_get_string(profile, "Output", "IPFamily");
+	// Automatic binding is resolved by the dock when the output starts
+	if (bind_ip && strcmp(bind_ip, "auto") == 0)
+		bind_ip = "default";
+	obs_data_t *output_settings = obs_data_create();
+	obs_data_set_string(output_settings, "bind_ip", bind_ip);
+	obs_data_set_string(output_settings, "ip_family", ip_family);
+	obs_output_update(output, output_settings);
+	obs_data_release(output_settings);
+	if (obs_data_get_bool(settings, "delay_custom")) {
+		auto delaySec = (uint32_t)obs_data_get_int(settings, "delay_sec");
+		bool preserveDelay = obs_data_get_bool(settings, "delay_preserve");
+		obs_output_set_delay(output, delaySec, preserveDelay ? OBS_OUTPUT_DELAY_PRESERVE : 0);
+	} else if (profile) {
+		bool useDelay = config_get_bool(profile, "Output", "DelayEnable");
+		auto delaySec = (uint32_t)config_get_int(profile, "Output", "DelaySec");
+		bool preserveDelay = config_get_bool(profile, "Output", "DelayPreserve");
+		obs_output_set_delay(output, useDelay ? delaySec : 0, preserveDelay ? OBS_OUTPUT_DELAY_PRESERVE : 0);
+	}
+	return output;
+}
+
+static std::string record_output_path(obs_data_t *settings, config_t *profile, const char *default_dir,
+				      const char *extension)
+{
+	std::string dir = obs_data_get_string(settings, "record_path");
+	if (dir.empty() && default_dir)
+		dir = default_dir;
+	if (dir.empty())
+		return dir;
+	os_mkdirs(dir.c_str());
+	if (dir.back() != '/' && dir.back() != '\\')
+		dir += "/";
+
+	std::string name = obs_data_get_string(settings, "name");
+	for (auto &c : name) {
+		if (strchr("/\\:*?\"<>|", c))
+			c = '_';
+	}
+	const char *format = nullptr;
+	if (profile)
+		format = config_get_string(profile, "Output", "FilenameFormatting");
+	if (!format || !*format)
+		format = "%CCYY-%MM-%DD %hh-%mm-%ss";
+	char *filename = os_generate_formatted_filename(extension, true, format);
+	dir += name;
+	dir += " ";
+	dir += filename;
+	bfree(filename);
+	return dir;
+}
+
+obs_output_t *create_record_output(obs_data_t *settings, config_t *profile, const char *default_dir)
+{
+	const char *name = obs_data_get_string(settings, "name");
+	const char *format = obs_data_get_string(settings, "record_format");
+	bool hybrid = strcmp(format, "hybrid_mp4") == 0;
+	const char *extension = strcmp(format, "mkv") == 0 ? "mkv" : "mp4";
+
+	auto path = record_output_path(settings, profile, default_dir, extension);
+	if (path.empty()) {
+		blog(LOG_WARNING, "[Aitum Multistream] failed to start recording for stream '%s' because no path is set", name);
+		return nullptr;
+	}
+
+	auto s = obs_data_create();
+	obs_data_set_string(s, "path", path.c_str());
+	std::string output_name = "aitum_multi_record_";
+	output_name += name;
+	auto output = obs_output_create(hybrid ? "mp4_output" : "ffmpeg_muxer", output_name.c_str(), s, nullptr);
+	obs_data_release(s);
+	if (!output)
+		blog(LOG_WARNING, "[Aitum Multistream] failed to create recording output for stream '%s'", name);
+	else
+		blog(LOG_INFO, "[Aitum Multistream] recording stream '%s' to '%s'", name, path.c_str());
+	return output;
+}
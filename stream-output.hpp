@@ -0,0 +1,19 @@
+#pragma once
+
+#include <obs.h>
+#include <util/config-file.h>
+
+// The record_mode of the output settings
+enum record_mode {
+	RECORD_MODE_STREAM = 0,
+	RECORD_MODE_STREAM_AND_RECORD = 1,
+	RECORD_MODE_RECORD = 2,
+};
+
+// Creates the network output and its service for the output settings. Bind address, IP family and delay fall back to
+// the profile when one is given, the dock passes the current profile and the loopback test none.
+obs_output_t *create_stream_output(obs_data_t *settings, config_t *profile);
+
+// Creates the muxer that records the stream of the output to a file, the encoders are set by the caller. The file goes to
+// the record_path of the settings or else default_dir, named by the profile's filename format.
+obs_output_t *create_record_output(obs_data_t *settings, config_t *profile, const char *default_dir);
@@ -0,0 +1,45 @@
+#include "loopback-test.hpp"
+#include "test-obs.hpp"
+#include <util/platform.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// Runs the loopback test without OBS: synthetic video, libobs audio, the real create_stream_output against the local
+// RTMP sink, and one more destination recording to record_dir with the same encoders. Fails when an output does not
+// start, connect or send, or the recording stays empty.
+//
+// Usage: aitum-multistream-loopback-test [outputs] [seconds] [results.json] [record_dir]
+int main(int argc, char **argv)
+{
+	int outputs = argc > 1 ? atoi(argv[1]) : 8;
+	int seconds = argc > 2 ? atoi(argv[2]) : 10;
+	std::string results = argc > 3 ? argv[3] : "loopback-test.json";
+	std::string recordDir = argc > 4 ? argv[4] : "loopback-recordings";
+	if (outputs < 1 || seconds < 1) {
+		fprintf(stderr, "usage: %s [outputs] [seconds] [results.json] [record_dir]\n", argv[0]);
+		return 2;
+	}
+
+	if (!test_obs_startup(nullptr)) {
+		fprintf(stderr, "Loopback test: failed to start libobs\n");
+		return 1;
+	}
+	int failures = 1;
+	{
+		TestVideo video;
+		if (!video.Open(640, 360, 30)) {
+			fprintf(stderr, "Loopback test: failed to open video output\n");
+		} else {
+			LoopbackTest test(
+				video.Get(), obs_get_audio(), outputs, seconds, results, recordDir,
+				[](const std::string &line) { printf("%s\n", line.c_str()); }, [] {});
+			while (test.Running())
+				os_sleep_ms(100);
+			failures = test.GetFailures();
+		}
+	}
+	test_obs_shutdown();
+	printf("Loopback test: %d failure(s)\n", failures);
+	return failures ? 1 : 0;
+}
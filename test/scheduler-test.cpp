@@ -0,0 +1,160 @@
+#include "output-scheduler.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+
+// Unit tests of the schedule parser, the next time of day across daylight saving time changes and the timer wheel
+// after clock jumps. Needs no OBS, only libobs for logging.
+//
+// Usage: aitum-multistream-scheduler-test
+
+static int failures = 0;
+
+static void check(bool ok, const char *expr, int line)
+{
+	if (ok)
+		return;
+	fprintf(stderr, "%s:%d: failed: %s\n", __FILE__, line, expr);
+	failures++;
+}
+
+#define CHECK(expr) check((expr), #expr, __LINE__)
+
+// US eastern time, daylight saving time from the second Sunday of March to the first Sunday of November
+static void set_eastern_time()
+{
+#ifdef _WIN32
+	_putenv_s("TZ", "EST5EDT");
+	_tzset();
+#else
+	setenv("TZ", "EST5EDT,M3.2.0,M11.1.0", 1);
+	tzset();
+#endif
+}
+
+static void test_parse()
+{
+	std::vector<schedule_entry> entries;
+	CHECK(schedule_parse("T+0; t+1:30:00; mon fri 20:00; 6:15:30", "a", true, false, entries));
+	CHECK(entries.size() == 4);
+	if (entries.size() == 4) {
+		CHECK(entries[0].trigger == SCHEDULE_AFTER_MAIN && entries[0].seconds == 0);
+		CHECK(entries[1].trigger == SCHEDULE_AFTER_MAIN && entries[1].seconds == 5400);
+		CHECK(entries[2].trigger == SCHEDULE_TIME_OF_DAY && entries[2].seconds == 20 * 3600);
+		CHECK(entries[2].days == ((1 << 1) | (1 << 5)));
+		CHECK(entries[3].seconds == 6 * 3600 + 15 * 60 + 30 && entries[3].days == 0);
+		CHECK(entries[3].name == "a" && entries[3].vertical && !entries[3].start);
+	}
+
+	entries.clear();
+	CHECK(schedule_parse(nullptr, "a", false, true, entries) && entries.empty());
+	CHECK(schedule_parse(" ; ;", "a", false, true, entries) && entries.empty());
+	CHECK(!schedule_parse("20", "a", false, true, entries));
+	CHECK(!schedule_parse("24:00", "a", false, true, entries));
+	CHECK(!schedule_parse("someday 20:00", "a", false, true, entries));
+	CHECK(!schedule_parse("T+x", "a", false, true, entries));
+	CHECK(!schedule_parse("1:2:3:4", "a", false, true, entries));
+}
+
+static void test_next_time()
+{
+	set_eastern_time();
+	schedule_entry daily;
+	daily.seconds = 20 * 3600;
+
+	// Saturday 2026-03-07 21:00 EST, the next 20:00 is on the Sunday the clocks go forward, 23 hours later
+	CHECK(schedule_next_time(daily, 1772935200) == 1773014400);
+	// Saturday 2026-10-31 20:00 EDT exactly, the next 20:00 is after the clocks go back, 25 hours later
+	CHECK(schedule_next_time(daily, 1793491200) == 1793581200);
+
+	// Saturday 2026-03-07 12:00 EST, the next Monday or Friday 20:00 is Monday 2026-03-09 20:00 EDT
+	schedule_entry weekdays = daily;
+	weekdays.days = (1 << 1) | (1 << 5);
+	CHECK(schedule_next_time(weekdays, 1772902800) == 1773100800);
+}
+
+static void test_wheel()
+{
+	std::vector<int> fired;
+	TimerWheel wheel;
+	wheel.Reset(1000);
+	wheel.Add(1010, 0, [&fired] { fired.push_back(1); });
+	wheel.Add(1010 + SCHEDULE_WHEEL_SLOTS, 0, [&fired] { fired.push_back(2); });
+	wheel.Advance(1005);
+	CHECK(fired.empty());
+	wheel.Advance(1010);
+	CHECK(fired == std::vector<int>({1}));
+
+	// A jump forward past the wheel size runs everything due and keeps the rest
+	wheel.Add(5000, 0, [&fired] { fired.push_back(3); });
+	wheel.Advance(3000);
+	CHECK(fired == std::vector<int>({1, 2}));
+	wheel.Advance(5000);
+	CHECK(fired == std::vector<int>({1, 2, 3}));
+
+	// A jump back runs nothing early, the timer fires once the clock reaches it again
+	fired.clear();
+	wheel.Add(5100, 0, [&fired] { fired.push_back(4); });
+	wheel.Advance(100);
+	CHECK(fired.empty());
+	wheel.Advance(5100);
+	CHECK(fired == std::vector<int>({4}));
+
+	// Overdue timers run on the next tick, cancelled groups never
+	fired.clear();
+	wheel.Add(10, 0, [&fired] { fired.push_back(5); });
+	wheel.Add(5105, 1, [&fired] { fired.push_back(6); });
+	wheel.CancelGroup(1);
+	wheel.Advance(5101);
+	wheel.Advance(5110);
+	CHECK(fired == std::vector<int>({5}));
+}
+
+static void test_scheduler()
+{
+	std::vector<std::string> calls;
+	OutputScheduler *scheduler = nullptr;
+	int reentered = 0;
+	scheduler = new OutputScheduler([&calls](const schedule_entry &entry) { calls.push_back("prepare " + entry.name); },
+					[&](const schedule_entry &entry) {
+						calls.push_back((entry.start ? "start " : "stop ") + entry.name);
+						// A start that runs a nested event loop ticks the scheduler again
+						reentered++;
+						scheduler->Tick(2000);
+						return true;
+					});
+	std::vector<schedule_entry> entries;
+	CHECK(schedule_parse("T+0:20", "a", false, true, entries));
+	CHECK(schedule_parse("T+0:30", "a", false, false, entries));
+	scheduler->Load(entries, 5, 1000);
+	scheduler->Tick(1010);
+	CHECK(calls.empty());
+	scheduler->MainStarted(1010);
+	scheduler->Tick(1025);
+	CHECK(calls == std::vector<std::string>({"prepare a"}));
+	scheduler->Tick(1030);
+	CHECK(calls == std::vector<std::string>({"prepare a", "start a"}));
+	scheduler->Tick(1040);
+	CHECK(calls == std::vector<std::string>({"prepare a", "start a", "stop a"}));
+	CHECK(reentered == 2);
+
+	// Schedules relative to the main stream are dropped when it stops
+	scheduler->MainStopped();
+	scheduler->MainStarted(1100);
+	scheduler->MainStopped();
+	scheduler->Tick(1200);
+	CHECK(calls.size() == 3);
+	delete scheduler;
+}
+
+int main()
+{
+	test_parse();
+	test_next_time();
+	test_wheel();
+	test_scheduler();
+	printf("Scheduler test: %d failure(s)\n", failures);
+	return failures ? 1 : 0;
+}
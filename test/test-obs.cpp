@@ -0,0 +1,103 @@
+#include "test-obs.hpp"
+#include <util/platform.h>
+#include <cstring>
+
+// Other modules could open devices, windows or network connections
+static const char *test_modules[] = {"obs-outputs", "obs-x264", "obs-ffmpeg", "rtmp-services"};
+
+static void load_test_module(void *param, const struct obs_module_info2 *info)
+{
+	UNUSED_PARAMETER(param);
+	for (auto name : test_modules) {
+		if (strcmp(info->name, name) != 0)
+			continue;
+		obs_module_t *module = nullptr;
+		if (obs_open_module(&module, info->bin_path, info->data_path) != MODULE_SUCCESS || !obs_init_module(module))
+			blog(LOG_WARNING, "[Aitum Multistream] failed to load module '%s'", name);
+		return;
+	}
+}
+
+bool test_obs_startup(const char *moduleConfigPath)
+{
+	if (!obs_startup("en-US", moduleConfigPath, nullptr))
+		return false;
+	struct obs_audio_info oai = {};
+	oai.samples_per_sec = 48000;
+	oai.speakers = SPEAKERS_STEREO;
+	if (!obs_reset_audio(&oai)) {
+		obs_shutdown();
+		return false;
+	}
+	obs_find_modules2(load_test_module, nullptr);
+	obs_post_load_modules();
+	return true;
+}
+
+void test_obs_shutdown()
+{
+	obs_shutdown();
+}
+
+TestVideo::~TestVideo()
+{
+	Close();
+}
+
+bool TestVideo::Open(uint32_t width_, uint32_t height_, uint32_t fps)
+{
+	struct video_output_info voi = {};
+	voi.name = "aitum_multistream_test";
+	voi.format = VIDEO_FORMAT_NV12;
+	voi.fps_num = fps;
+	voi.fps_den = 1;
+	voi.width = width_ & ~1u;
+	voi.height = height_ & ~1u;
+	voi.cache_size = 16;
+	voi.colorspace = VIDEO_CS_709;
+	voi.range = VIDEO_RANGE_PARTIAL;
+	if (video_output_open(&video, &voi) != VIDEO_OUTPUT_SUCCESS) {
+		video = nullptr;
+		return false;
+	}
+	width = voi.width;
+	height = voi.height;
+	interval = 1000000000ULL / fps;
+	stop = false;
+	thread = std::thread(&TestVideo::Run, this);
+	return true;
+}
+
+void TestVideo::Close()
+{
+	stop = true;
+	if (thread.joinable())
+		thread.join();
+	if (video) {
+		video_output_close(video);
+		video = nullptr;
+	}
+}
+
+// Gray frames with a bar moving across, so the encoder has motion to encode
+void TestVideo::Run()
+{
+	os_set_thread_name("aitum-multistream-test-video");
+	uint64_t next = os_gettime_ns();
+	for (uint64_t n = 0; !stop; n++) {
+		os_sleepto_ns(next);
+		struct video_frame frame;
+		if (video_output_lock_frame(video, &frame, 1, next)) {
+			uint32_t bar = (uint32_t)(n * 8 % width);
+			for (uint32_t y = 0; y < height; y++) {
+				uint8_t *row = frame.data[0] + (size_t)y * frame.linesize[0];
+				memset(row, 128, width);
+				memset(row + bar, 235, bar + 16 < width ? 16 : width - bar);
+			}
+			for (uint32_t y = 0; y < height / 2; y++)
+				memset(frame.data[1] + (size_t)y * frame.linesize[1], 128, width);
+			video_output_unlock_frame(video);
+		}
+		next += interval;
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <obs.h>
+#include <atomic>
+#include <thread>
+
+// Starts libobs with audio but no graphics and loads only the modules the tests stream and encode with. Modules are
+// found in the default OBS paths, OBS_PLUGINS_PATH and OBS_PLUGINS_DATA_PATH point elsewhere.
+bool test_obs_startup(const char *moduleConfigPath);
+void test_obs_shutdown();
+
+// Video output fed with moving NV12 frames from its own thread, stands in for the canvas that needs graphics
+class TestVideo {
+public:
+	~TestVideo();
+
+	bool Open(uint32_t width, uint32_t height, uint32_t fps);
+	void Close();
+
+	video_t *Get() const { return video; }
+
+private:
+	video_t *video = nullptr;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint64_t interval = 0;
+	std::thread thread;
+	std::atomic<bool> stop = false;
+
+	void Run();
+};
@@ -0,0 +1,41 @@
+#include "test-obs.hpp"
+#include <QApplication>
+#include <QTemporaryDir>
+#include <util/platform.h>
+#include <cstdio>
+#include <string>
+
+// Runs the UI benchmark of the plugin on the offscreen Qt platform. The plugin is opened but never loaded, so it adds no
+// dock, contacts no server and reads no OBS profile; its configuration goes to a temporary directory.
+//
+// Usage: aitum-multistream-ui-benchmark [plugin] [results.json]
+int main(int argc, char **argv)
+{
+	qputenv("QT_QPA_PLATFORM", "offscreen");
+	QApplication app(argc, argv);
+	const char *plugin = argc > 1 ? argv[1] : UI_BENCHMARK_PLUGIN;
+	std::string results = argc > 2 ? argv[2] : "ui-benchmark.json";
+
+	QTemporaryDir config;
+	if (!config.isValid() || !test_obs_startup(config.path().toUtf8().constData())) {
+		fprintf(stderr, "UI benchmark: failed to start libobs\n");
+		return 1;
+	}
+	int result = 1;
+	obs_module_t *module = nullptr;
+	if (obs_open_module(&module, plugin, UI_BENCHMARK_DATA) != MODULE_SUCCESS) {
+		fprintf(stderr, "UI benchmark: failed to open %s\n", plugin);
+	} else {
+		auto lib = obs_get_module_lib(module);
+		auto set_locale = (void (*)(const char *))os_dlsym(lib, "obs_module_set_locale");
+		auto run = (int (*)(const char *))os_dlsym(lib, "aitum_multistream_ui_benchmark");
+		if (set_locale)
+			set_locale("en-US");
+		if (run)
+			result = run(results.c_str());
+		else
+			fprintf(stderr, "UI benchmark: %s was built without ENABLE_UI_BENCHMARK\n", plugin);
+	}
+	test_obs_shutdown();
+	return result;
+}
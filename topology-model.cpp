@@ -0,0 +1,379 @@
+#include "topology-model.hpp"
+#include "transport.hpp"
+#include <obs-module.h>
+#include <util/platform.h>
+#include <QColor>
+#include <QStringList>
+#include <algorithm>
+#include <map>
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
+static bool obs_encoder_parent_video_loaded = false;
+static video_t *(*obs_encoder_parent_video_wrapper)(const obs_encoder_t *encoder) = nullptr;
+
+// obs_encoder_parent_video is newer than the libobs this plugin builds against
+static void load_encoder_parent_video()
+{
+	if (obs_encoder_parent_video_loaded)
+		return;
+#ifdef _WIN32
+	void *dl = os_dlopen("obs");
+#else
+	void *dl = dlopen(nullptr, RTLD_LAZY);
+#endif
+	if (dl) {
+		auto sym = os_dlsym(dl, "obs_encoder_parent_video");
+		if (sym)
+			obs_encoder_parent_video_wrapper = (video_t * (*)(const obs_encoder_t *encoder)) sym;
+		os_dlclose(dl);
+	}
+	obs_encoder_parent_video_loaded = true;
+}
+
+struct topology_context {
+	std::vector<topology_row> rows;
+	video_t *vertical_video;
+	const std::vector<video_t *> *old_videos;
+	std::vector<video_t *> custom_videos;
+};
+
+static void topology_add_row(topology_context *context, obs_output_t *output, obs_encoder_t *encoder)
+{
+	topology_row row;
+	video_t *video = nullptr;
+	if (encoder)
+		video = obs_encoder_parent_video_wrapper ? obs_encoder_parent_video_wrapper(encoder) : obs_encoder_video(encoder);
+	if (!video)
+		video = obs_output_video(output);
+	const bool old = video &&
+			 std::find(context->old_videos->begin(), context->old_videos->end(), video) != context->old_videos->end();
+	if (!video) {
+		row.canvas_index = INT32_MAX;
+		row.canvas = "No Canvas";
+	} else if (context->vertical_video && context->vertical_video == video) {
+		row.canvas_index = 1;
+		row.canvas = "Vertical Canvas";
+	} else if (video == obs_get_video()) {
+		row.canvas_index = 0;
+		row.canvas = "Main Canvas";
+	} else if (old) {
+		row.canvas_index = 2;
+		row.canvas = "Old Main Canvas";
+	} else {
+		auto it = std::find(context->custom_videos.begin(), context->custom_videos.end(), video);
+		if (it == context->custom_videos.end())
+			it = context->custom_videos.insert(it, video);
+		row.canvas_index = 3 + (int)(it - context->custom_videos.begin());
+		row.canvas = "Custom Canvas " + std::to_string(row.canvas_index - 2);
+	}
+
+	if (encoder && !old) {
+		row.encoder_key = (uintptr_t)encoder;
+		row.encoder = obs_encoder_get_name(encoder);
+		row.encoder_id = obs_encoder_get_id(encoder);
+		auto settings = obs_encoder_get_settings(encoder);
+		row.encoder_settings = obs_data_get_json(settings);
+		obs_data_release(settings);
+		row.encoder_video = (uintptr_t)obs_encoder_video(encoder);
+		row.width = obs_encoder_get_width(encoder);
+		row.height = obs_encoder_get_height(encoder);
+		row.divisor = obs_encoder_get_frame_rate_divisor(encoder);
+		row.encoder_active = obs_encoder_active(encoder);
+		row.scaled = video && (row.width != video_output_get_width(video) || row.height != video_output_get_height(video));
+		if (video)
+			row.fps = video_output_get_frame_rate(video) / (row.divisor ? row.divisor : 1);
+	} else if (video && !old) {
+		row.width = video_output_get_width(video);
+		row.height = video_output_get_height(video);
+		row.fps = video_output_get_frame_rate(video);
+		row.encoder_active = video_output_active(video);
+	} else {
+		row.width = obs_output_get_width(output);
+		row.height = obs_output_get_height(output);
+	}
+	if (video && !old) {
+		row.skipped_frames = video_output_get_skipped_frames(video);
+		row.video_frames = video_output_get_total_frames(video);
+	}
+
+	row.output = obs_output_get_name(output);
+	row.output_id = obs_output_get_id(output);
+	row.output_active = obs_output_active(output);
+	row.connect_ms = obs_output_get_connect_time_ms(output);
+	row.dropped_frames = obs_output_get_frames_dropped(output);
+	row.total_frames = obs_output_get_total_frames(output);
+	obs_service_t *service = obs_output_get_service(output);
+	if (service) {
+		row.service = obs_service_get_name(service);
+		row.service_id = obs_service_get_id(service);
+		auto url = obs_service_get_connect_info(service, OBS_SERVICE_CONNECT_INFO_SERVER_URL);
+		if (url)
+			row.url = transport_display_url(url);
+	}
+	context->rows.push_back(std::move(row));
+}
+
+std::vector<topology_row> topology_collect(video_t *vertical_video, const std::vector<video_t *> &old_videos)
+{
+	load_encoder_parent_video();
+	topology_context context;
+	context.vertical_video = vertical_video;
+	context.old_videos = &old_videos;
+	// The output list stays locked during the walk, so nothing used here is destroyed under it
+	obs_enum_outputs(
+		[](void *param, obs_output_t *output) {
+			auto context = (topology_context *)param;
+			bool found = false;
+			for (size_t i = 0; i < MAX_OUTPUT_VIDEO_ENCODERS; i++) {
+				auto encoder = obs_output_get_video_encoder2(output, i);
+				if (!encoder)
+					continue;
+				found = true;
+				topology_add_row(context, output, encoder);
+			}
+			if (!found)
+				topology_add_row(context, output, nullptr);
+			return true;
+		},
+		&context);
+
+	auto &rows = context.rows;
+	std::stable_sort(rows.begin(), rows.end(), [](const topology_row &a, const topology_row &b) {
+		if (a.canvas_index != b.canvas_index)
+			return a.canvas_index < b.canvas_index;
+		if (a.encoder_key != b.encoder_key)
+			return a.encoder_key < b.encoder_key;
+		return a.output < b.output;
+	});
+
+	std::map<uintptr_t, int> encoder_outputs;
+	for (auto &row : rows) {
+		if (row.encoder_key)
+			encoder_outputs[row.encoder_key]++;
+	}
+	for (auto &row : rows) {
+		if (!row.encoder_key)
+			continue;
+		row.encoder_outputs = encoder_outputs[row.encoder_key];
+		for (auto &other : rows) {
+			if (!other.encoder_key || other.encoder_key == row.encoder_key || other.canvas_index != row.canvas_index ||
+			    other.width != row.width || other.height != row.height)
+				continue;
+			// Two encoders doing exactly the same work, one of them could serve both outputs
+			if (row.duplicate_encoder.empty() && other.encoder_id == row.encoder_id && other.divisor == row.divisor &&
+			    other.encoder_settings == row.encoder_settings)
+				row.duplicate_encoder = other.encoder;
+			// Same size from the same canvas scaled twice instead of sharing one scaled mix
+			if (row.duplicate_scaling.empty() && row.scaled && other.encoder_video != row.encoder_video)
+				row.duplicate_scaling = other.encoder;
+		}
+	}
+	return rows;
+}
+
+TopologyModel::TopologyModel(QObject *parent) : QAbstractTableModel(parent) {}
+
+TopologyModel::~TopologyModel()
+{
+	if (worker.joinable())
+		worker.join();
+}
+
+int TopologyModel::rowCount(const QModelIndex &parent) const
+{
+	return parent.isValid() ? 0 : (int)rows.size();
+}
+
+int TopologyModel::columnCount(const QModelIndex &parent) const
+{
+	return parent.isValid() ? 0 : ColumnCount;
+}
+
+static QString topology_notes(const topology_row &row)
+{
+	QStringList notes;
+	if (row.encoder_outputs > 1)
+		notes.append(QString::fromUtf8(obs_module_text("TopologyShared")).arg(row.encoder_outputs));
+	if (!row.duplicate_encoder.empty())
+		notes.append(QString::fromUtf8(obs_module_text("TopologyDuplicateEncoder"))
+				     .arg(QString::fromUtf8(row.duplicate_encoder.c_str())));
+	if (!row.duplicate_scaling.empty())
+		notes.append(QString::fromUtf8(obs_module_text("TopologyDuplicateScaling"))
+				     .arg(QString::fromUtf8(row.duplicate_scaling.c_str())));
+	return notes.join(QString::fromUtf8(", "));
+}
+
+QVariant TopologyModel::data(const QModelIndex &index, int role) const
+{
+	if (!index.isValid() || index.row() >= (int)rows.size())
+		return QVariant();
+	auto &row = rows[index.row()];
+	if (role == Qt::BackgroundRole) {
+		if (!row.duplicate_encoder.empty() || !row.duplicate_scaling.empty())
+			return QColor(230, 126, 34, 90);
+		return QVariant();
+	}
+	if (role != Qt::DisplayRole && role != Qt::ToolTipRole)
+		return QVariant();
+	switch (index.column()) {
+	case CanvasColumn:
+		return QString::fromUtf8(row.canvas.c_str());
+	case EncoderColumn:
+		if (row.encoder.empty())
+			return QString();
+		return QString::fromUtf8((row.encoder + " (" + row.encoder_id + ")").c_str());
+	case ResolutionColumn:
+		return QString::fromUtf8("%1x%2").arg(row.width).arg(row.height);
+	case FpsColumn:
+		return row.fps > 0.0 ? QString::number(row.fps, 'f', 2) : QString();
+	case OutputColumn:
+		return QString::fromUtf8((row.output + " (" + row.output_id + ")").c_str());
+	case StateColumn:
+		return QString::fromUtf8(obs_module_text(row.output_active ? "TopologyActive" : "TopologyInactive"));
+	case FramesColumn: {
+		auto frames = QString::fromUtf8(obs_module_text("TopologyDropped")).arg(row.dropped_frames).arg(row.total_frames);
+		if (row.video_frames) {
+			frames += QString::fromUtf8(", ");
+			auto skipped = QString::fromUtf8(obs_module_text("TopologySkipped"));
+			frames += skipped.arg(row.skipped_frames).arg(row.video_frames);
+		}
+		return frames;
+	}
+	case ConnectColumn:
+		return QString::fromUtf8("%1 ms").arg(row.connect_ms);
+	case ServiceColumn:
+		if (row.service.empty())
+			return QString();
+		return QString::fromUtf8((row.service + " " + row.url).c_str());
+	case NotesColumn:
+		return topology_notes(row);
+	}
+	return QVariant();
+}
+
+QVariant TopologyModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+	if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+		return QVariant();
+	static const char *headers[] = {"TopologyCanvas",  "TopologyEncoder", "TopologyResolution", "TopologyFps",
+					"TopologyOutput",  "TopologyState",   "TopologyFrames",     "TopologyConnect",
+					"TopologyService", "TopologyNotes"};
+	if (section < 0 || section >= ColumnCount)
+		return QVariant();
+	return QString::fromUtf8(obs_module_text(headers[section]));
+}
+
+void TopologyModel::Refresh()
+{
+	if (collecting)
+		return;
+	if (worker.joinable())
+		worker.join();
+	collecting = true;
+	video_t *vertical_video = nullptr;
+	struct calldata cd;
+	calldata_init(&cd);
+	if (proc_handler_call(obs_get_proc_handler(), "aitum_vertical_get_video", &cd))
+		vertical_video = (video_t *)calldata_ptr(&cd, "video");
+	calldata_free(&cd);
+	worker = std::thread([this, vertical_video, old_videos = oldVideos] {
+		auto collected = topology_collect(vertical_video, old_videos);
+		QMetaObject::invokeMethod(
+			this, [this, collected]() mutable { SetRows(std::move(collected)); }, Qt::QueuedConnection);
+		collecting = false;
+	});
+}
+
+void TopologyModel::SetRows(std::vector<topology_row> collected)
+{
+	// Same shape keeps the selection and scroll position of the view
+	if (collected.size() == rows.size() && !rows.empty()) {
+		rows = std::move(collected);
+		emit dataChanged(index(0, 0), index((int)rows.size() - 1, ColumnCount - 1));
+		return;
+	}
+	beginResetModel();
+	rows = std::move(collected);
+	endResetModel();
+}
+
+// Nested the way the pieces hang together: canvases, their encoders, the outputs on each encoder and their service
+bool TopologyModel::ExportJson(const char *path) const
+{
+	auto root = obs_data_create();
+	auto canvases = obs_data_array_create();
+	obs_data_t *canvas = nullptr;
+	obs_data_array_t *encoders = nullptr;
+	obs_data_t *encoder = nullptr;
+	obs_data_array_t *outputs = nullptr;
+	auto flush_encoder = [&] {
+		if (!encoder)
+			return;
+		obs_data_set_array(encoder, "outputs", outputs);
+		obs_data_array_release(outputs);
+		obs_data_array_push_back(encoders, encoder);
+		obs_data_release(encoder);
+		encoder = nullptr;
+	};
+	auto flush_canvas = [&] {
+		if (!canvas)
+			return;
+		flush_encoder();
+		obs_data_set_array(canvas, "encoders", encoders);
+		obs_data_array_release(encoders);
+		obs_data_array_push_back(canvases, canvas);
+		obs_data_release(canvas);
+		canvas = nullptr;
+	};
+	const topology_row *previous = nullptr;
+	for (auto &row : rows) {
+		if (!previous || previous->canvas_index != row.canvas_index) {
+			flush_canvas();
+			canvas = obs_data_create();
+			obs_data_set_string(canvas, "name", row.canvas.c_str());
+			encoders = obs_data_array_create();
+		}
+		if (!encoder || previous->encoder_key != row.encoder_key || !row.encoder_key) {
+			flush_encoder();
+			encoder = obs_data_create();
+			obs_data_set_string(encoder, "name", row.encoder.c_str());
+			obs_data_set_string(encoder, "id", row.encoder_id.c_str());
+			obs_data_set_int(encoder, "width", row.width);
+			obs_data_set_int(encoder, "height", row.height);
+			obs_data_set_double(encoder, "fps", row.fps);
+			obs_data_set_bool(encoder, "active", row.encoder_active);
+			obs_data_set_bool(encoder, "scaled", row.scaled);
+			obs_data_set_int(encoder, "skipped_frames", row.skipped_frames);
+			obs_data_set_int(encoder, "video_frames", row.video_frames);
+			obs_data_set_string(encoder, "duplicate_of", row.duplicate_encoder.c_str());
+			obs_data_set_string(encoder, "scaled_separately_from", row.duplicate_scaling.c_str());
+			outputs = obs_data_array_create();
+		}
+		auto output = obs_data_create();
+		obs_data_set_string(output, "name", row.output.c_str());
+		obs_data_set_string(output, "id", row.output_id.c_str());
+		obs_data_set_bool(output, "active", row.output_active);
+		obs_data_set_int(output, "connect_time_ms", row.connect_ms);
+		obs_data_set_int(output, "dropped_frames", row.dropped_frames);
+		obs_data_set_int(output, "total_frames", row.total_frames);
+		if (!row.service.empty()) {
+			auto service = obs_data_create();
+			obs_data_set_string(service, "name", row.service.c_str());
+			obs_data_set_string(service, "id", row.service_id.c_str());
+			obs_data_set_string(service, "url", row.url.c_str());
+			obs_data_set_obj(output, "service", service);
+			obs_data_release(service);
+		}
+		obs_data_array_push_back(outputs, output);
+		obs_data_release(output);
+		previous = &row;
+	}
+	flush_canvas();
+	obs_data_set_array(root, "canvases", canvases);
+	obs_data_array_release(canvases);
+	bool saved = obs_data_save_json(root, path);
+	obs_data_release(root);
+	return saved;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <obs.h>
+#include <QAbstractTableModel>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One output and the encoder it uses, the canvas and service come along
+struct topology_row {
+	int canvas_index = 0;
+	std::string canvas;
+	uintptr_t encoder_key = 0;
+	std::string encoder;
+	std::string encoder_id;
+	std::string encoder_settings;
+	uintptr_t encoder_video = 0;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t divisor = 1;
+	double fps = 0.0;
+	bool encoder_active = false;
+	uint32_t skipped_frames = 0;
+	uint32_t video_frames = 0;
+	std::string output;
+	std::string output_id;
+	bool output_active = false;
+	int connect_ms = 0;
+	int dropped_frames = 0;
+	int total_frames = 0;
+	std::string service;
+	std::string service_id;
+	std::string url;
+	bool scaled = false;
+	int encoder_outputs = 0;
+	std::string duplicate_encoder;
+	std::string duplicate_scaling;
+};
+
+// Walks canvases, encoders, outputs and services. Safe to call off the UI thread.
+std::vector<topology_row> topology_collect(video_t *vertical_video, const std::vector<video_t *> &old_videos);
+
+// Snapshot of the topology for the troubleshooter. Refresh collects on a worker thread and swaps the rows in on the UI
+// thread. Encoders doing the same work twice are highlighted.
+class TopologyModel : public QAbstractTableModel {
+	Q_OBJECT
+
+public:
+	enum Column {
+		CanvasColumn,
+		EncoderColumn,
+		ResolutionColumn,
+		FpsColumn,
+		OutputColumn,
+		StateColumn,
+		FramesColumn,
+		ConnectColumn,
+		ServiceColumn,
+		NotesColumn,
+		ColumnCount,
+	};
+
+	explicit TopologyModel(QObject *parent = nullptr);
+	~TopologyModel();
+
+	int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+	int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+	QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+	void SetOldVideos(const std::vector<video_t *> &videos) { oldVideos = videos; }
+	void Refresh();
+	bool ExportJson(const char *path) const;
+
+private:
+	std::vector<topology_row> rows;
+	std::vector<video_t *> oldVideos;
+	std::thread worker;
+	std::atomic<bool> collecting = false;
+
+	void SetRows(std::vector<topology_row> rows);
+};
@@ -0,0 +1,136 @@
+#include "trace.hpp"
+#include <obs-module.h>
+#include <util/platform.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+struct trace_event {
+	const char *name;
+	uint64_t start;
+	uint64_t end;
+};
+
+// Event slot guarded by a sequence number: 0 while the writer fills it, otherwise the index it holds plus one
+struct trace_slot {
+	std::atomic<uint64_t> seq = 0;
+	std::atomic<const char *> name = nullptr;
+	std::atomic<uint64_t> start = 0;
+	std::atomic<uint64_t> end = 0;
+};
+
+// Single writer ring. head only grows, readers take a slot only if its sequence is the same before and after the copy.
+struct trace_ring {
+	uint32_t tid = 0;
+	std::atomic<bool> in_use = true;
+	std::atomic<uint64_t> head = 0;
+	trace_slot slots[TRACE_RING_SIZE];
+};
+
+static std::mutex rings_mutex;
+static std::vector<trace_ring *> rings;
+static uint32_t next_tid = 1;
+
+// Hands the ring back when the thread exits, output and encoder threads come and go with every start
+struct trace_ring_owner {
+	trace_ring *ring = nullptr;
+	~trace_ring_owner()
+	{
+		if (ring)
+			ring->in_use = false;
+	}
+};
+
+static thread_local trace_ring_owner ring_owner;
+
+static trace_ring *thread_ring()
+{
+	if (ring_owner.ring)
+		return ring_owner.ring;
+	std::lock_guard<std::mutex> lock(rings_mutex);
+	for (auto ring : rings) {
+		if (ring->in_use)
+			continue;
+		ring->in_use = true;
+		ring->tid = next_tid++;
+		ring_owner.ring = ring;
+		return ring;
+	}
+	auto ring = new trace_ring;
+	ring->tid = next_tid++;
+	rings.push_back(ring);
+	ring_owner.ring = ring;
+	return ring;
+}
+
+void trace_record(const char *name, uint64_t start_ns, uint64_t end_ns)
+{
+	auto ring = thread_ring();
+	uint64_t head = ring->head.load(std::memory_order_relaxed);
+	auto &slot = ring->slots[head % TRACE_RING_SIZE];
+	slot.seq.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.name.store(name, std::memory_order_relaxed);
+	slot.start.store(start_ns, std::memory_order_relaxed);
+	slot.end.store(end_ns, std::memory_order_relaxed);
+	slot.seq.store(head + 1, std::memory_order_release);
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+TraceScope::TraceScope(const char *name_) : name(name_), start(os_gettime_ns()) {}
+
+TraceScope::~TraceScope()
+{
+	trace_record(name, start, os_gettime_ns());
+}
+
+int trace_export_chrome(const char *path)
+{
+	std::vector<std::pair<uint32_t, trace_event>> events;
+	{
+		std::lock_guard<std::mutex> lock(rings_mutex);
+		for (auto ring : rings) {
+			uint64_t head = ring->head.load(std::memory_order_acquire);
+			uint64_t first = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+			for (uint64_t i = first; i < head; i++) {
+				auto &slot = ring->slots[i % TRACE_RING_SIZE];
+				// Skips slots the writer is filling or has already wrapped over
+				if (slot.seq.load(std::memory_order_acquire) != i + 1)
+					continue;
+				trace_event event = {slot.name.load(std::memory_order_relaxed),
+						     slot.start.load(std::memory_order_relaxed),
+						     slot.end.load(std::memory_order_relaxed)};
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (slot.seq.load(std::memory_order_relaxed) == i + 1)
+					events.emplace_back(ring->tid, event);
+			}
+		}
+	}
+
+	uint64_t origin = UINT64_MAX;
+	for (auto &event : events)
+		origin = event.second.start < origin ? event.second.start : origin;
+
+	auto trace = obs_data_create();
+	auto array = obs_data_array_create();
+	for (auto &event : events) {
+		auto item = obs_data_create();
+		obs_data_set_string(item, "name", event.second.name);
+		obs_data_set_string(item, "ph", "X");
+		obs_data_set_double(item, "ts", (double)(event.second.start - origin) / 1000.0);
+		obs_data_set_double(item, "dur", (double)(event.second.end - event.second.start) / 1000.0);
+		obs_data_set_int(item, "pid", 1);
+		obs_data_set_int(item, "tid", event.first);
+		obs_data_array_push_back(array, item);
+		obs_data_release(item);
+	}
+	obs_data_set_array(trace, "traceEvents", array);
+	obs_data_array_release(array);
+	obs_data_set_string(trace, "displayTimeUnit", "ms");
+	bool saved = obs_data_save_json(trace, path);
+	obs_data_release(trace);
+	if (!saved)
+		return -1;
+	blog(LOG_INFO, "[Aitum Multistream] wrote %d trace events to %s", (int)events.size(), path);
+	return (int)events.size();
+}
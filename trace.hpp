@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+
+// Events each thread keeps, older ones are overwritten
+#define TRACE_RING_SIZE 4096
+
+// Records a completed span in the ring of the calling thread. The name must be a string literal, only the pointer is
+// stored. Writing takes no lock, every thread owns its ring.
+void trace_record(const char *name, uint64_t start_ns, uint64_t end_ns);
+
+// Writes what the rings hold in the Chrome trace event format, for chrome://tracing or Perfetto. Returns the number of
+// events written or -1 when the file could not be saved.
+int trace_export_chrome(const char *path);
+
+class TraceScope {
+public:
+	explicit TraceScope(const char *name);
+	~TraceScope();
+
+	TraceScope(const TraceScope &) = delete;
+	TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+	const char *name;
+	uint64_t start;
+};
+
+#define TRACE_CONCAT2(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT2(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(name)
@@ -0,0 +1,201 @@
+#include "transport.hpp"
+#include <cstring>
+
+bool parse_stream_url(const char *url, stream_url &parsed)
+{
+	parsed = stream_url();
+	if (!url)
+		return false;
+	const char *sep = strstr(url, "://");
+	if (!sep || sep == url)
+		return false;
+	parsed.scheme.assign(url, sep - url);
+	for (auto &c : parsed.scheme)
+		c = (char)tolower(c);
+
+	const char *host = sep + 3;
+	const char *host_end = host + strcspn(host, "/?#");
+	const char *at = (const char *)memchr(host, '@', host_end - host);
+	if (at)
+		host = at + 1;
+	const char *port = nullptr;
+	if (*host == '[') {
+		const char *bracket = (const char *)memchr(host, ']', host_end - host);
+		if (!bracket)
+			return false;
+		parsed.host.assign(host + 1, bracket - host - 1);
+		if (bracket + 1 < host_end && bracket[1] == ':')
+			port = bracket + 2;
+	} else {
+		const char *colon = (const char *)memchr(host, ':', host_end - host);
+		parsed.host.assign(host, (colon ? colon : host_end) - host);
+		if (colon)
+			port = colon + 1;
+	}
+	if (parsed.host.empty())
+		return false;
+	if (port) {
+		char *end = nullptr;
+		long p = strtol(port, &end, 10);
+		if (end == port || end != host_end || p <= 0 || p > 65535)
+			return false;
+		parsed.port = (int)p;
+	}
+	return true;
+}
+
+bool transport_from_server(const char *server, transport &t)
+{
+	t = transport();
+	if (!parse_stream_url(server, t.url))
+		return false;
+	const auto &scheme = t.url.scheme;
+	if (scheme == "rtmp") {
+		t.protocol = TRANSPORT_RTMP;
+		t.output_id = "rtmp_output";
+		t.needs_key = true;
+	} else if (scheme == "rtmps") {
+		t.protocol = TRANSPORT_RTMPS;
+		t.output_id = "rtmp_output";
+		t.needs_key = true;
+	} else if (scheme == "srt") {
+		t.protocol = TRANSPORT_SRT;
+		t.needs_port = true;
+	} else if (scheme == "rist") {
+		t.protocol = TRANSPORT_RIST;
+		t.needs_port = true;
+	} else if (scheme == "ftl") {
+		t.protocol = TRANSPORT_FTL;
+		t.output_id = "ftl_output";
+	} else if ((scheme == "http" || scheme == "https") && strstr(server, "whip")) {
+		t.protocol = TRANSPORT_WHIP;
+		t.service_id = "whip_custom";
+		t.output_id = "whip_output";
+		t.needs_key = true;
+	} else if (scheme == "udp" || scheme == "tcp") {
+		t.protocol = TRANSPORT_MPEGTS;
+	}
+	return t.protocol != TRANSPORT_UNKNOWN;
+}
+
+static bool has_query_option(const std::string &url, const char *name)
+{
+	auto query = url.find('?');
+	if (query == std::string::npos)
+		return false;
+	size_t len = strlen(name);
+	size_t pos = query;
+	while (pos != std::string::npos) {
+		pos++;
+		if (url.compare(pos, len, name) == 0 && (pos + len == url.size() || url[pos + len] == '='))
+			return true;
+		pos = url.find('&', pos);
+	}
+	return false;
+}
+
+static void add_query_option(std::string &url, const char *name, const std::string &value)
+{
+	if (value.empty() || has_query_option(url, name))
+		return;
+	url += url.find('?') == std::string::npos ? "?" : "&";
+	url += name;
+	url += "=";
+	static const char hex[] = "0123456789ABCDEF";
+	for (unsigned char c : value) {
+		if (isalnum(c) || strchr("-_.~", c)) {
+			url += (char)c;
+		} else {
+			url += '%';
+			url += hex[c >> 4];
+			url += hex[c & 15];
+		}
+	}
+}
+
+std::string transport_server_url(const char *server, const transport &t, obs_data_t *settings)
+{
+	std::string url = server ? server : "";
+	auto latency = obs_data_get_int(settings, "transport_latency");
+	std::string passphrase = obs_data_get_string(settings, "transport_passphrase");
+	auto pbkeylen = obs_data_get_int(settings, "transport_pbkeylen");
+	if (t.protocol == TRANSPORT_SRT) {
+		// libsrt takes the latency in microseconds
+		if (latency > 0)
+			add_query_option(url, "latency", std::to_string(latency * 1000));
+		add_query_option(url, "passphrase", passphrase);
+		if (pbkeylen > 0 && !passphrase.empty())
+			add_query_option(url, "pbkeylen", std::to_string(pbkeylen));
+		auto buffer_size = obs_data_get_int(settings, "transport_buffer_size");
+		if (buffer_size > 0)
+			add_query_option(url, "send_buffer_size", std::to_string(buffer_size));
+		auto packet_size = obs_data_get_int(settings, "transport_packet_size");
+		if (packet_size > 0)
+			add_query_option(url, "payload_size", std::to_string(packet_size));
+	} else if (t.protocol == TRANSPORT_RIST) {
+		// librist has no send buffer or packet size option, its buffer is the latency in milliseconds
+		if (latency > 0)
+			add_query_option(url, "buffer", std::to_string(latency));
+		add_query_option(url, "secret", passphrase);
+		if (pbkeylen > 0 && !passphrase.empty())
+			add_query_option(url, "aes-type", std::to_string(pbkeylen * 8));
+	}
+	return url;
+}
+
+std::string transport_display_url(const char *server)
+{
+	std::string url = server ? server : "";
+	// Password of the user info
+	auto sep = url.find("://");
+	if (sep != std::string::npos) {
+		auto host = sep + 3;
+		auto host_end = url.find_first_of("/?#", host);
+		auto at = url.rfind('@', host_end == std::string::npos ? std::string::npos : host_end - 1);
+		if (at != std::string::npos && at >= host) {
+			auto colon = url.find(':', host);
+			if (colon != std::string::npos && colon < at)
+				url.replace(colon + 1, at - colon - 1, "***");
+		}
+	}
+	// SRT passphrase and RIST secret query options
+	auto query = url.find('?');
+	while (query != std::string::npos) {
+		auto start = query + 1;
+		auto end = url.find_first_of("&#", start);
+		auto eq = url.find('=', start);
+		if (eq != std::string::npos && (end == std::string::npos || eq < end)) {
+			auto name = url.substr(start, eq - start);
+			if (name == "passphrase" || name == "secret") {
+				url.replace(eq + 1, (end == std::string::npos ? url.size() : end) - eq - 1, "***");
+				end = url.find_first_of("&#", start);
+			}
+		}
+		if (end == std::string::npos || url[end] == '#')
+			break;
+		query = end;
+	}
+	return url;
+}
+
+const char *transport_protocol_name(transport_protocol protocol)
+{
+	switch (protocol) {
+	case TRANSPORT_RTMP:
+		return "RTMP";
+	case TRANSPORT_RTMPS:
+		return "RTMPS";
+	case TRANSPORT_SRT:
+		return "SRT";
+	case TRANSPORT_RIST:
+		return "RIST";
+	case TRANSPORT_WHIP:
+		return "WHIP";
+	case TRANSPORT_FTL:
+		return "FTL";
+	case TRANSPORT_MPEGTS:
+		return "MPEG-TS";
+	default:
+		return "Unknown";
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <obs.h>
+#include <string>
+
+enum transport_protocol {
+	TRANSPORT_UNKNOWN = 0,
+	TRANSPORT_RTMP = 1,
+	TRANSPORT_RTMPS = 2,
+	TRANSPORT_SRT = 3,
+	TRANSPORT_RIST = 4,
+	TRANSPORT_WHIP = 5,
+	TRANSPORT_FTL = 6,
+	TRANSPORT_MPEGTS = 7,
+};
+
+struct stream_url {
+	std::string scheme;
+	std::string host;
+	int port = 0;
+};
+
+struct transport {
+	transport_protocol protocol = TRANSPORT_UNKNOWN;
+	stream_url url;
+	const char *service_id = "rtmp_custom";
+	const char *output_id = "ffmpeg_mpegts_muxer";
+	bool needs_key = false;
+	bool needs_port = false;
+};
+
+bool parse_stream_url(const char *url, stream_url &parsed);
+
+// Parses the server URL once and picks the protocol, output type and service for it
+bool transport_from_server(const char *server, transport &t);
+
+// Server URL with the SRT or RIST options of the output settings added as query parameters,
+// options already present in the URL are left untouched
+std::string transport_server_url(const char *server, const transport &t, obs_data_t *settings);
+
+// Server URL safe to show or export, with the user info password and the SRT and RIST passphrases masked
+std::string transport_display_url(const char *server);
+
+const char *transport_protocol_name(transport_protocol protocol);
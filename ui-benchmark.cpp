@@ -0,0 +1,183 @@
+#include "ui-benchmark.hpp"
+#include "multistream.hpp"
+#include "output-dialog.hpp"
+#include "version.h"
+#include <obs-module.h>
+#include <util/platform.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#define UI_BENCHMARK_REPEAT 3
+
+static const int ui_benchmark_sizes[] = {1, 10, 50, 200};
+
+// Median wall time in milliseconds of UI_BENCHMARK_REPEAT runs
+template<typename F> static double ui_benchmark_time(F f)
+{
+	double times[UI_BENCHMARK_REPEAT];
+	for (int i = 0; i < UI_BENCHMARK_REPEAT; i++) {
+		uint64_t start = os_gettime_ns();
+		f();
+		times[i] = (double)(os_gettime_ns() - start) / 1000000.0;
+	}
+	std::sort(times, times + UI_BENCHMARK_REPEAT);
+	return times[UI_BENCHMARK_REPEAT / 2];
+}
+
+static obs_data_array_t *ui_benchmark_outputs(int count, bool vertical)
+{
+	const char *video_encoder = nullptr;
+	const char *type;
+	size_t idx = 0;
+	while (obs_enum_encoder_types(idx++, &type)) {
+		if (strcmp(type, "obs_x264") == 0) {
+			video_encoder = type;
+			break;
+		}
+	}
+	auto outputs = obs_data_array_create();
+	for (int i = 0; i < count; i++) {
+		auto output = obs_data_create();
+		auto name = QString::fromUtf8(vertical ? "Benchmark Vertical %1" : "Benchmark %1").arg(i + 1);
+		obs_data_set_string(output, "name", name.toUtf8().constData());
+		obs_data_set_string(output, "stream_server", "rtmp://127.0.0.1/live");
+		obs_data_set_string(output, "stream_key", "benchmark");
+		obs_data_set_bool(output, "enabled", true);
+		obs_data_set_string(output, "id", name.toUtf8().constData());
+		if (video_encoder) {
+			obs_data_set_bool(output, "advanced", true);
+			obs_data_set_string(output, "video_encoder", video_encoder);
+			obs_data_set_string(output, "audio_encoder", "ffmpeg_aac");
+		}
+		obs_data_array_push_back(outputs, output);
+		obs_data_release(output);
+	}
+	return outputs;
+}
+
+int UiBenchmark::Run(const char *resultsPath, QString &report)
+{
+	int failures = 0;
+	auto fail = [&report, &failures](const char *step, int count) {
+		report += QString::fromUtf8("UI benchmark %1 output(s): %2 failed\n").arg(count).arg(QString::fromUtf8(step));
+		failures++;
+	};
+	auto results = obs_data_create();
+	auto runs = obs_data_array_create();
+	// Rows only, the benchmark must not start timers, hotkeys or preflight probes
+	auto dock = new MultistreamDock(nullptr, false);
+	for (auto count : ui_benchmark_sizes) {
+		auto run = obs_data_create();
+		obs_data_set_int(run, "outputs", count);
+
+		auto config = obs_data_create();
+		auto main_outputs = ui_benchmark_outputs(count, false);
+		obs_data_set_array(config, "outputs", main_outputs);
+		obs_data_set_bool(config, "preflight_probe", false);
+
+		// Dock rows for the main canvas, rows are kept across loads so every run builds them from scratch
+		obs_data_release(dock->current_config);
+		dock->current_config = config;
+		obs_data_addref(config);
+		double dock_load = ui_benchmark_time([dock] {
+			dock->RemoveOutputRows(false);
+			dock->LoadSettings();
+		});
+		if (dock->mainRows->rowCount() != count)
+			fail("dock LoadSettings", count);
+
+		// Dock rows for the vertical canvas
+		obs_data_array_release(dock->vertical_outputs);
+		dock->vertical_outputs = ui_benchmark_outputs(count, true);
+		double dock_vertical = ui_benchmark_time([dock] {
+			dock->RemoveOutputRows(true);
+			dock->LoadVerticalOutputRows();
+		});
+		if (dock->verticalRows->rowCount() != count)
+			fail("dock LoadVerticalOutputs", count);
+
+		double dock_tick = ui_benchmark_time([dock] { dock->VideoCheckTick(); });
+
+		// Settings dialog, LoadSettings adds every output through AddServer
+		auto dialog = new OBSBasicSettings;
+		double settings_load = ui_benchmark_time([dialog, config] { dialog->LoadSettings(config); });
+
+		// One more output added to a dialog that already shows count outputs
+		auto dialog_outputs = obs_data_get_array(dialog->main_settings, "outputs");
+		int added = 0;
+		double add_server = ui_benchmark_time([dialog, dialog_outputs, &added] {
+			auto output = obs_data_create();
+			auto name = QString::fromUtf8("Benchmark Added %1").arg(++added);
+			obs_data_set_string(output, "name", name.toUtf8().constData());
+			obs_data_set_string(output, "stream_server", "rtmp://127.0.0.1/live");
+			obs_data_array_push_back(dialog_outputs, output);
+			dialog->AddServer(dialog->mainOutputsLayout, output, dialog_outputs);
+			obs_data_release(output);
+		});
+		if (obs_data_array_count(dialog_outputs) != (size_t)(count + added))
+			fail("settings AddServer", count);
+		obs_data_array_release(dialog_outputs);
+
+		QStringList otherNames;
+		obs_data_array_enum(
+			main_outputs,
+			[](obs_data_t *data2, void *param) {
+				((QStringList *)param)->append(QString::fromUtf8(obs_data_get_string(data2, "name")));
+			},
+			&otherNames);
+		double output_dialog = ui_benchmark_time([dialog, otherNames] { delete new OutputDialog(dialog, otherNames); });
+		delete dialog;
+
+		obs_data_array_release(main_outputs);
+		obs_data_release(config);
+
+		obs_data_set_double(run, "dock_load_settings_ms", dock_load);
+		obs_data_set_double(run, "dock_load_vertical_outputs_ms", dock_vertical);
+		obs_data_set_double(run, "dock_video_check_tick_ms", dock_tick);
+		obs_data_set_double(run, "settings_load_settings_ms", settings_load);
+		obs_data_set_double(run, "settings_add_server_ms", add_server);
+		obs_data_set_double(run, "output_dialog_ms", output_dialog);
+		obs_data_array_push_back(runs, run);
+		obs_data_release(run);
+
+		report += QString::fromUtf8(
+				  "UI benchmark %1 output(s): dock LoadSettings %2ms, LoadVerticalOutputs %3ms, timer tick %4ms, "
+				  "settings LoadSettings %5ms, AddServer %6ms, OutputDialog %7ms\n")
+				  .arg(count)
+				  .arg(dock_load, 0, 'f', 2)
+				  .arg(dock_vertical, 0, 'f', 2)
+				  .arg(dock_tick, 0, 'f', 2)
+				  .arg(settings_load, 0, 'f', 2)
+				  .arg(add_server, 0, 'f', 2)
+				  .arg(output_dialog, 0, 'f', 2);
+	}
+	delete dock;
+	obs_data_set_int(results, "timestamp", (long long)time(nullptr));
+	obs_data_set_string(results, "version", PROJECT_VERSION);
+	obs_data_set_int(results, "repeat", UI_BENCHMARK_REPEAT);
+	obs_data_set_array(results, "runs", runs);
+	obs_data_array_release(runs);
+	if (resultsPath && *resultsPath) {
+		if (obs_data_save_json_safe(results, resultsPath, "tmp", "bak")) {
+			report += QString::fromUtf8("UI benchmark: results saved to %1").arg(QString::fromUtf8(resultsPath));
+		} else {
+			report += QString::fromUtf8("UI benchmark: failed to save results to %1")
+					  .arg(QString::fromUtf8(resultsPath));
+			failures++;
+		}
+	}
+	obs_data_release(results);
+	blog(failures ? LOG_WARNING : LOG_INFO, "[Aitum Multistream] %s", report.toUtf8().constData());
+	return failures;
+}
+
+// Entry point for the benchmark program, which opens the plugin without loading it so no dock is added to OBS
+extern "C" EXPORT int aitum_multistream_ui_benchmark(const char *resultsPath)
+{
+	QString report;
+	int failures = UiBenchmark::Run(resultsPath, report);
+	printf("%s\n", report.toUtf8().constData());
+	return failures ? 1 : 0;
+}
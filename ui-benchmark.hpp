@@ -0,0 +1,12 @@
+#pragma once
+
+#include <QString>
+
+// Times the dock and settings dialog hot paths at 1, 10, 50 and 200 outputs. Everything runs on a dock and dialog of its
+// own with generated outputs, the dock OBS shows is never touched. Built with ENABLE_UI_BENCHMARK, which also builds the
+// aitum-multistream-ui-benchmark program that loads the plugin and calls aitum_multistream_ui_benchmark.
+class UiBenchmark {
+public:
+	// Returns the number of steps that failed, the timings and failures go to report
+	static int Run(const char *resultsPath, QString &report);
+};